@@ -0,0 +1,468 @@
+#include "Bot.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using boost::asio::ip::tcp;
+
+// ---- little endian payload helpers, same layout as ByteBuffer on the server ----
+
+static void AppendUInt32(std::vector<uint8>& buf, uint32 value)
+{
+	for (int i = 0; i < 4; ++i)
+		buf.push_back(uint8(value >> (i * 8)));
+}
+
+static void AppendFloat(std::vector<uint8>& buf, float value)
+{
+	uint32 raw;
+	memcpy(&raw, &value, sizeof(raw));
+	AppendUInt32(buf, raw);
+}
+
+static void AppendString(std::vector<uint8>& buf, std::string const& value)
+{
+	buf.insert(buf.end(), value.begin(), value.end());
+	buf.push_back(0);
+}
+
+static bool ReadUInt32(std::vector<uint8> const& buf, size_t& pos, uint32& value)
+{
+	if (pos + 4 > buf.size())
+		return false;
+
+	value = uint32(buf[pos]) | (uint32(buf[pos + 1]) << 8) | (uint32(buf[pos + 2]) << 16) | (uint32(buf[pos + 3]) << 24);
+	pos += 4;
+	return true;
+}
+
+static bool ReadFloat(std::vector<uint8> const& buf, size_t& pos, float& value)
+{
+	uint32 raw;
+	if (!ReadUInt32(buf, pos, raw))
+		return false;
+
+	memcpy(&value, &raw, sizeof(value));
+	return true;
+}
+
+static uint32 RandomDelay(uint32 maxDelay)
+{
+	static thread_local std::mt19937 generator(std::random_device{}());
+	return maxDelay ? std::uniform_int_distribution<uint32>(0, maxDelay)(generator) : 0;
+}
+
+Bot::Bot(boost::asio::io_service& service, BotConfig const& config, BotStats& stats, uint32 index)
+	: m_socket(service), m_moveTimer(service), m_pingTimer(service),
+	m_config(config), m_stats(stats), m_index(index), m_state(STATE_CLOSED), m_queued(false),
+	m_pingSeq(0), m_lastRtt(0), m_centerX(0.0f), m_centerY(0.0f), m_z(0.0f), m_angle(0.0f)
+{
+}
+
+void Bot::Start()
+{
+	if (!m_config.authHost.empty())
+		ConnectAuthServer();
+	else
+		ConnectWorldServer();
+}
+
+void Bot::Stop()
+{
+	if (m_state == STATE_CLOSED)
+		return;
+
+	SetState(STATE_CLOSED);
+	SetQueued(false);
+	boost::system::error_code ec;
+	m_moveTimer.cancel(ec);
+	m_pingTimer.cancel(ec);
+	m_socket.close(ec);
+}
+
+/// The auth login packet is a packed struct holding a std::string, its layout depends on the server's
+/// standard library, so the bot only measures connecting to the auth server before going on.
+void Bot::ConnectAuthServer()
+{
+	SetState(STATE_AUTH_SERVER);
+	m_phaseStart = Clock::now();
+
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string(m_config.authHost), m_config.authPort);
+	auto self = shared_from_this();
+	m_socket.async_connect(endpoint, [self](boost::system::error_code const& error)
+	{
+		if (self->m_state == STATE_CLOSED)
+			return;
+		if (error)
+			return self->Fail("auth server connect", error);
+
+		self->m_stats.authConnect.Add(MicrosSince(self->m_phaseStart));
+
+		boost::system::error_code ec;
+		self->m_socket.close(ec);
+		self->ConnectWorldServer();
+	});
+}
+
+void Bot::ConnectWorldServer()
+{
+	SetState(STATE_CONNECTING);
+	m_phaseStart = Clock::now();
+
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string(m_config.host), m_config.port);
+	auto self = shared_from_this();
+	m_socket.async_connect(endpoint, [self](boost::system::error_code const& error)
+	{
+		if (self->m_state == STATE_CLOSED)
+			return;
+		if (error)
+			return self->Fail("world server connect", error);
+
+		self->m_stats.connect.Add(MicrosSince(self->m_phaseStart));
+
+		boost::system::error_code ec;
+		self->m_socket.set_option(tcp::no_delay(true), ec);
+
+		self->SetState(STATE_CHALLENGE);
+		self->ReadHeader();
+	});
+}
+
+/// Server header: uint16 size (big endian, payload + 4), uint16 opcode
+void Bot::ReadHeader()
+{
+	auto self = shared_from_this();
+	boost::asio::async_read(m_socket, boost::asio::buffer(m_header, sizeof(m_header)),
+		[self](boost::system::error_code const& error, size_t /*length*/)
+	{
+		if (self->m_state == STATE_CLOSED)
+			return;
+		if (error)
+			return self->Fail("read header", error);
+
+		uint16 size = uint16((self->m_header[0] << 8) | self->m_header[1]);
+		uint16 opcode = uint16(self->m_header[2] | (self->m_header[3] << 8));
+		if (size < 4)
+			return self->Fail("malformed server header");
+
+		self->ReadBody(opcode, size - 4);
+	});
+}
+
+void Bot::ReadBody(uint16 opcode, uint16 size)
+{
+	m_body.resize(size);
+	if (!size)
+	{
+		m_stats.packetsReceived.fetch_add(1, std::memory_order_relaxed);
+		m_stats.bytesReceived.fetch_add(sizeof(m_header), std::memory_order_relaxed);
+		HandlePacket(opcode, m_body);
+		if (m_state != STATE_CLOSED)
+			ReadHeader();
+		return;
+	}
+
+	auto self = shared_from_this();
+	boost::asio::async_read(m_socket, boost::asio::buffer(m_body),
+		[self, opcode](boost::system::error_code const& error, size_t length)
+	{
+		if (self->m_state == STATE_CLOSED)
+			return;
+		if (error)
+			return self->Fail("read body", error);
+
+		self->m_stats.packetsReceived.fetch_add(1, std::memory_order_relaxed);
+		self->m_stats.bytesReceived.fetch_add(sizeof(self->m_header) + length, std::memory_order_relaxed);
+		self->HandlePacket(opcode, self->m_body);
+		if (self->m_state != STATE_CLOSED)
+			self->ReadHeader();
+	});
+}
+
+void Bot::HandlePacket(uint16 opcode, std::vector<uint8> const& body)
+{
+	switch (opcode)
+	{
+		case BOT_SMSG_AUTH_CHALLENGE:
+			HandleAuthChallenge();
+			break;
+		case BOT_SMSG_AUTH_RESPONSE:
+			HandleAuthResponse(body);
+			break;
+		case BOT_SMSG_CHAR_ENUM:
+			HandleCharEnum(body);
+			break;
+		case BOT_SMSG_LOGIN_VERIFY_WORLD:
+			HandleLoginVerifyWorld(body);
+			break;
+		case BOT_SMSG_LOGIN_FINISHED:
+			HandleLoginFinished();
+			break;
+		case BOT_SMSG_PONG:
+			HandlePong(body);
+			break;
+		default:
+			// object updates and movement of others only count for throughput
+			break;
+	}
+}
+
+void Bot::HandleAuthChallenge()
+{
+	if (m_state != STATE_CHALLENGE)
+		return;
+
+	char account[64];
+	snprintf(account, sizeof(account), "%s%u", m_config.accountPrefix.c_str(), m_config.accountOffset + m_index);
+
+	std::vector<uint8> payload;
+	AppendString(payload, account);
+	AppendString(payload, m_config.password);
+	AppendUInt32(payload, m_config.build);
+	AppendUInt32(payload, 0);
+
+	SetState(STATE_AUTH_RESPONSE);
+	m_phaseStart = Clock::now();
+	Send(BOT_CMSG_AUTH_SESSION, payload);
+}
+
+void Bot::HandleAuthResponse(std::vector<uint8> const& body)
+{
+	if (m_state != STATE_AUTH_RESPONSE || body.empty())
+		return;
+
+	if (body[0] == BOT_AUTH_WAIT_QUEUE)
+	{
+		// position updates arrive until the server lets us in
+		SetQueued(true);
+		return;
+	}
+
+	SetQueued(false);
+
+	if (body[0] != BOT_AUTH_OK)
+		return Fail("auth session refused");
+
+	m_stats.handshake.Add(MicrosSince(m_phaseStart));
+
+	SetState(STATE_CHAR_ENUM);
+	m_phaseStart = Clock::now();
+	Send(BOT_CMSG_CHAR_ENUM, std::vector<uint8>());
+}
+
+/// uint8 count, then per character uint32 guid, name, ... we only need the first guid
+void Bot::HandleCharEnum(std::vector<uint8> const& body)
+{
+	if (m_state != STATE_CHAR_ENUM)
+		return;
+
+	m_stats.charEnum.Add(MicrosSince(m_phaseStart));
+
+	size_t pos = 1;
+	uint32 guid;
+	if (body.empty() || !body[0] || !ReadUInt32(body, pos, guid))
+		return Fail("account has no character");
+
+	std::vector<uint8> payload;
+	AppendUInt32(payload, guid);
+
+	SetState(STATE_LOGIN);
+	m_phaseStart = Clock::now();
+	Send(BOT_CMSG_PLAYER_LOGIN, payload);
+}
+
+/// uint32 map, x, y, z, orientation
+void Bot::HandleLoginVerifyWorld(std::vector<uint8> const& body)
+{
+	size_t pos = 0;
+	uint32 mapId;
+	float orientation;
+	if (!ReadUInt32(body, pos, mapId) || !ReadFloat(body, pos, m_centerX) || !ReadFloat(body, pos, m_centerY) ||
+		!ReadFloat(body, pos, m_z) || !ReadFloat(body, pos, orientation))
+		return Fail("malformed SMSG_LOGIN_VERIFY_WORLD");
+
+	m_angle = orientation;
+}
+
+void Bot::HandleLoginFinished()
+{
+	if (m_state != STATE_LOGIN)
+		return;
+
+	m_stats.login.Add(MicrosSince(m_phaseStart));
+
+	Send(BOT_CMSG_ENTER_WORLD_FINISHED, std::vector<uint8>());
+	SetState(STATE_IN_WORLD);
+
+	ScheduleMove();
+	// spread the pings, or all bots started together ping in the same tick
+	ScheduleRandomPing(m_config.pingInterval);
+}
+
+void Bot::HandlePong(std::vector<uint8> const& body)
+{
+	size_t pos = 0;
+	uint32 seq;
+	if (!ReadUInt32(body, pos, seq) || seq != m_pingSeq)
+		return;
+
+	uint64 rtt = MicrosSince(m_pingSent);
+	m_stats.rtt.Add(rtt);
+	m_lastRtt = uint32(rtt / 1000);
+}
+
+void Bot::ScheduleMove()
+{
+	if (!m_config.moveInterval)
+		return;
+
+	m_moveTimer.expires_from_now(std::chrono::milliseconds(m_config.moveInterval));
+	auto self = shared_from_this();
+	m_moveTimer.async_wait([self](boost::system::error_code const& error)
+	{
+		if (error || self->m_state != STATE_IN_WORLD)
+			return;
+
+		// walk in a circle around the login position
+		self->m_angle += 0.1f;
+		std::vector<uint8> payload;
+		AppendFloat(payload, self->m_centerX + self->m_config.moveRadius * std::cos(self->m_angle));
+		AppendFloat(payload, self->m_centerY + self->m_config.moveRadius * std::sin(self->m_angle));
+		AppendFloat(payload, self->m_z);
+		AppendFloat(payload, self->m_angle);
+		self->Send(BOT_MSG_MOVEMENT, payload);
+		self->m_stats.movesSent.fetch_add(1, std::memory_order_relaxed);
+
+		self->ScheduleMove();
+	});
+}
+
+void Bot::ScheduleRandomPing(uint32 maxDelay)
+{
+	SchedulePing(RandomDelay(maxDelay));
+}
+
+void Bot::SchedulePing(uint32 delay)
+{
+	if (!m_config.pingInterval)
+		return;
+
+	m_pingTimer.expires_from_now(std::chrono::milliseconds(delay));
+	auto self = shared_from_this();
+	m_pingTimer.async_wait([self](boost::system::error_code const& error)
+	{
+		if (error || self->m_state != STATE_IN_WORLD)
+			return;
+
+		std::vector<uint8> payload;
+		AppendUInt32(payload, ++self->m_pingSeq);
+		AppendUInt32(payload, self->m_lastRtt);
+		self->m_pingSent = Clock::now();
+		self->Send(BOT_CMSG_PING, payload);
+
+		self->SchedulePing(self->m_config.pingInterval);
+	});
+}
+
+void Bot::Send(uint16 opcode, std::vector<uint8> const& payload)
+{
+	std::vector<uint8> packet;
+	packet.reserve(6 + payload.size());
+
+	uint16 size = uint16(payload.size() + 4);
+	packet.push_back(uint8(size >> 8));
+	packet.push_back(uint8(size));
+	AppendUInt32(packet, opcode);
+	packet.insert(packet.end(), payload.begin(), payload.end());
+
+	m_stats.packetsSent.fetch_add(1, std::memory_order_relaxed);
+	m_stats.bytesSent.fetch_add(packet.size(), std::memory_order_relaxed);
+
+	m_sendQueue.push_back(std::move(packet));
+	if (m_sendQueue.size() == 1)
+		WriteNext();
+}
+
+void Bot::WriteNext()
+{
+	auto self = shared_from_this();
+	boost::asio::async_write(m_socket, boost::asio::buffer(m_sendQueue.front()),
+		[self](boost::system::error_code const& error, size_t /*length*/)
+	{
+		if (self->m_state == STATE_CLOSED)
+			return;
+		if (error)
+			return self->Fail("write", error);
+
+		self->m_sendQueue.pop_front();
+		if (!self->m_sendQueue.empty())
+			self->WriteNext();
+	});
+}
+
+void Bot::Fail(char const* reason, boost::system::error_code const& error)
+{
+	if (m_state == STATE_CLOSED)
+		return;
+
+	if (m_state == STATE_IN_WORLD)
+		m_stats.disconnected.fetch_add(1, std::memory_order_relaxed);
+	else
+		m_stats.failed.fetch_add(1, std::memory_order_relaxed);
+
+	if (error)
+		fprintf(stderr, "bot %u: %s: %s\n", m_index, reason, error.message().c_str());
+	else
+		fprintf(stderr, "bot %u: %s\n", m_index, reason);
+
+	Stop();
+}
+
+/// Keep the per state gauges of BotStats in sync
+void Bot::SetState(State state)
+{
+	auto gauge = [this](State s) -> std::atomic<uint32>*
+	{
+		switch (s)
+		{
+			case STATE_AUTH_SERVER:
+			case STATE_CONNECTING:
+			case STATE_CHALLENGE:
+			case STATE_AUTH_RESPONSE:
+				return &m_stats.connecting;
+			case STATE_CHAR_ENUM:
+			case STATE_LOGIN:
+				return &m_stats.authed;
+			case STATE_IN_WORLD:
+				return &m_stats.inWorld;
+			default:
+				return nullptr;
+		}
+	};
+
+	if (std::atomic<uint32>* old = gauge(m_state))
+		old->fetch_sub(1, std::memory_order_relaxed);
+	if (std::atomic<uint32>* now = gauge(state))
+		now->fetch_add(1, std::memory_order_relaxed);
+
+	m_state = state;
+}
+
+void Bot::SetQueued(bool queued)
+{
+	if (queued == m_queued)
+		return;
+
+	if (queued)
+		m_stats.queued.fetch_add(1, std::memory_order_relaxed);
+	else
+		m_stats.queued.fetch_sub(1, std::memory_order_relaxed);
+	m_queued = queued;
+}
+
+uint64 Bot::MicrosSince(Clock::time_point start)
+{
+	return uint64(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+}
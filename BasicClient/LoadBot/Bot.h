@@ -0,0 +1,127 @@
+#ifndef _BOT_H
+#define _BOT_H
+
+#include "../../src/Shared/Define.h"
+#include "BotStats.h"
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Opcodes the bot speaks, values of OpcodesList in src/game/Server/Opcodes.h
+enum BotOpcodes
+{
+	BOT_SMSG_AUTH_CHALLENGE       = 0x001,
+	BOT_CMSG_AUTH_SESSION         = 0x002,
+	BOT_SMSG_AUTH_RESPONSE        = 0x003,
+	BOT_CMSG_CHAR_ENUM            = 0x006,
+	BOT_SMSG_CHAR_ENUM            = 0x007,
+	BOT_CMSG_PLAYER_LOGIN         = 0x00a,
+	BOT_CMSG_PING                 = 0x00f,
+	BOT_SMSG_PONG                 = 0x010,
+	BOT_SMSG_LOGIN_VERIFY_WORLD   = 0x012,
+	BOT_SMSG_LOGIN_FINISHED       = 0x013,
+	BOT_CMSG_ENTER_WORLD_FINISHED = 0x014,
+	BOT_MSG_MOVEMENT              = 0x018
+};
+
+/// ResponseCodes of SMSG_AUTH_RESPONSE, see src/game/Server/SharedDefine.h
+#define BOT_AUTH_OK         0x0C
+#define BOT_AUTH_WAIT_QUEUE 0x1B
+
+struct BotConfig
+{
+	std::string host;
+	uint16 port;
+	std::string authHost;                                   // empty: skip the auth server
+	uint16 authPort;
+
+	std::string accountPrefix;                              // account name is prefix + index
+	uint32 accountOffset;
+	std::string password;                                   // sent as is, the server compares it with account.md5
+	uint32 build;
+
+	uint32 moveInterval;                                    // ms between MSG_MOVEMENT, 0 disables movement
+	uint32 pingInterval;                                    // ms between CMSG_PING, keep above 27000 or the server counts over-speed pings
+	float moveRadius;
+};
+
+/// One simulated client: connect, CMSG_AUTH_SESSION, char enum, login, enter world, then move and ping.
+/// A bot only runs on the thread of its io_service, so it needs no locking.
+class Bot : public std::enable_shared_from_this<Bot>
+{
+public:
+	Bot(boost::asio::io_service& service, BotConfig const& config, BotStats& stats, uint32 index);
+
+	void Start();
+	void Stop();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	enum State
+	{
+		STATE_AUTH_SERVER,
+		STATE_CONNECTING,
+		STATE_CHALLENGE,
+		STATE_AUTH_RESPONSE,
+		STATE_CHAR_ENUM,
+		STATE_LOGIN,
+		STATE_IN_WORLD,
+		STATE_CLOSED
+	};
+
+	void ConnectAuthServer();
+	void ConnectWorldServer();
+	void ReadHeader();
+	void ReadBody(uint16 opcode, uint16 size);
+	void HandlePacket(uint16 opcode, std::vector<uint8> const& body);
+
+	void HandleAuthChallenge();
+	void HandleAuthResponse(std::vector<uint8> const& body);
+	void HandleCharEnum(std::vector<uint8> const& body);
+	void HandleLoginVerifyWorld(std::vector<uint8> const& body);
+	void HandleLoginFinished();
+	void HandlePong(std::vector<uint8> const& body);
+
+	void ScheduleMove();
+	void ScheduleRandomPing(uint32 maxDelay);
+	void SchedulePing(uint32 delay);
+
+	/// Frame a client packet: uint16 size (big endian, payload + 4), uint32 opcode, payload
+	void Send(uint16 opcode, std::vector<uint8> const& payload);
+	void WriteNext();
+
+	void Fail(char const* reason, boost::system::error_code const& error = boost::system::error_code());
+	void SetState(State state);
+	void SetQueued(bool queued);
+
+	static uint64 MicrosSince(Clock::time_point start);
+
+	boost::asio::ip::tcp::socket m_socket;
+	boost::asio::steady_timer m_moveTimer;
+	boost::asio::steady_timer m_pingTimer;
+	BotConfig const& m_config;
+	BotStats& m_stats;
+	uint32 const m_index;
+
+	State m_state;
+	bool m_queued;
+	uint8 m_header[4];
+	std::vector<uint8> m_body;
+	std::deque<std::vector<uint8>> m_sendQueue;
+
+	Clock::time_point m_phaseStart;
+	Clock::time_point m_pingSent;
+	uint32 m_pingSeq;
+	uint32 m_lastRtt;
+
+	float m_centerX, m_centerY, m_z;
+	float m_angle;
+};
+
+#endif
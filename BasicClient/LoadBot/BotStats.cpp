@@ -0,0 +1,75 @@
+#include "BotStats.h"
+
+#include <cstdio>
+
+LatencyHistogram::LatencyHistogram() : m_count(0), m_max(0)
+{
+	for (int i = 0; i < Buckets; ++i)
+		m_buckets[i] = 0;
+}
+
+int LatencyHistogram::BucketOf(uint64 micros)
+{
+	if (micros < 1)
+		micros = 1;
+
+	int power = 63 - __builtin_clzll(micros);
+	// the two bits below the leading one pick the sub bucket
+	int sub = power >= 2 ? int((micros >> (power - 2)) & 3) : int((micros << (2 - power)) & 3);
+
+	int bucket = power * SubBuckets + sub;
+	return bucket < Buckets ? bucket : Buckets - 1;
+}
+
+uint64 LatencyHistogram::UpperBound(int bucket)
+{
+	int power = bucket / SubBuckets;
+	int sub = bucket % SubBuckets;
+	return (uint64(1) << power) + ((uint64(1) << power) * (sub + 1)) / SubBuckets;
+}
+
+void LatencyHistogram::Add(uint64 micros)
+{
+	m_buckets[BucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+
+	uint64 max = m_max.load(std::memory_order_relaxed);
+	while (micros > max && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed))
+		;
+}
+
+uint64 LatencyHistogram::GetPercentile(double percentile) const
+{
+	uint64 count = GetCount();
+	if (!count)
+		return 0;
+
+	uint64 rank = uint64(percentile / 100.0 * count + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	uint64 seen = 0;
+	for (int i = 0; i < Buckets; ++i)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return UpperBound(i) < GetMax() ? UpperBound(i) : GetMax();
+	}
+
+	return GetMax();
+}
+
+std::string LatencyHistogram::Summary() const
+{
+	char buf[160];
+	snprintf(buf, sizeof(buf), "n=%llu p50=%.2fms p95=%.2fms p99=%.2fms max=%.2fms",
+		(unsigned long long)GetCount(), GetPercentile(50) / 1000.0, GetPercentile(95) / 1000.0,
+		GetPercentile(99) / 1000.0, GetMax() / 1000.0);
+	return buf;
+}
+
+BotStats::BotStats() :
+	connecting(0), authed(0), queued(0), inWorld(0), failed(0), disconnected(0),
+	packetsSent(0), packetsReceived(0), bytesSent(0), bytesReceived(0), movesSent(0)
+{
+}
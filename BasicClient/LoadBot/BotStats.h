@@ -0,0 +1,64 @@
+#ifndef _BOTSTATS_H
+#define _BOTSTATS_H
+
+#include "../../src/Shared/Define.h"
+
+#include <atomic>
+#include <string>
+
+/// Lock free latency histogram, shared by all bot threads.
+/// Buckets are powers of two in microseconds, each split in 4, so percentiles are within ~20%.
+class LatencyHistogram
+{
+public:
+	static const int SubBuckets = 4;
+	static const int Buckets = 36 * SubBuckets;             // 1 us .. ~19 h
+
+	LatencyHistogram();
+
+	void Add(uint64 micros);
+
+	uint64 GetCount() const { return m_count.load(std::memory_order_relaxed); }
+	/// upper bound of the bucket holding the given percentile (0-100), in microseconds
+	uint64 GetPercentile(double percentile) const;
+	uint64 GetMax() const { return m_max.load(std::memory_order_relaxed); }
+
+	/// "n=1234 p50=1.2ms p95=3.4ms p99=5.6ms max=7.8ms"
+	std::string Summary() const;
+
+private:
+	static int BucketOf(uint64 micros);
+	static uint64 UpperBound(int bucket);
+
+	std::atomic<uint64> m_buckets[Buckets];
+	std::atomic<uint64> m_count;
+	std::atomic<uint64> m_max;
+};
+
+/// Everything the bots report, read by the main thread every report interval
+struct BotStats
+{
+	BotStats();
+
+	std::atomic<uint32> connecting;
+	std::atomic<uint32> authed;
+	std::atomic<uint32> queued;                             // waiting in the server login queue
+	std::atomic<uint32> inWorld;
+	std::atomic<uint32> failed;
+	std::atomic<uint32> disconnected;
+
+	std::atomic<uint64> packetsSent;
+	std::atomic<uint64> packetsReceived;
+	std::atomic<uint64> bytesSent;
+	std::atomic<uint64> bytesReceived;
+	std::atomic<uint64> movesSent;
+
+	LatencyHistogram authConnect;                           // TCP connect to the auth server
+	LatencyHistogram connect;                               // TCP connect to the world server
+	LatencyHistogram handshake;                             // SMSG_AUTH_CHALLENGE received .. SMSG_AUTH_RESPONSE AUTH_OK
+	LatencyHistogram charEnum;                              // CMSG_CHAR_ENUM .. SMSG_CHAR_ENUM
+	LatencyHistogram login;                                 // CMSG_PLAYER_LOGIN .. SMSG_LOGIN_FINISHED
+	LatencyHistogram rtt;                                   // CMSG_PING .. SMSG_PONG
+};
+
+#endif
@@ -0,0 +1,227 @@
+/// Headless load generator for capacity planning, Linux and any other platform boost::asio runs on.
+/// Every bot logs in to the world server like BasicClient, enters the world, then moves and pings
+/// at the configured rates. Connect, handshake, char enum, login and ping round trip latencies plus
+/// the packet and byte rates are printed every report interval and once more at the end.
+///
+/// Accounts are <prefix><offset + index>, each needs a character, all share one password (account.md5).
+///
+/// Build: g++ -std=c++17 -O2 -pthread Main.cpp Bot.cpp BotStats.cpp -o loadbot -lboost_system
+
+#include "Bot.h"
+#include "BotStats.h"
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<bool> s_stop(false);
+
+static void OnSignal(int)
+{
+	s_stop = true;
+}
+
+static void Usage(char const* program)
+{
+	printf("Usage: %s [options]\n"
+		"  --host <ip>              world server address (127.0.0.1)\n"
+		"  --port <port>            world server port (8085)\n"
+		"  --auth <ip:port>         connect to the auth server first (off)\n"
+		"  --clients <n>            number of bots (100)\n"
+		"  --ramp <n>               bots started per second, 0 = all at once (50)\n"
+		"  --threads <n>            network threads (hardware concurrency)\n"
+		"  --account <prefix>       account name prefix (bot)\n"
+		"  --offset <n>             first account index (0)\n"
+		"  --password <md5>         password sent in CMSG_AUTH_SESSION (bot)\n"
+		"  --build <n>              client build (1499)\n"
+		"  --move-interval <ms>     MSG_MOVEMENT interval, 0 = stand still (500)\n"
+		"  --move-radius <yards>    radius of the walked circle (10)\n"
+		"  --ping-interval <ms>     CMSG_PING interval, 0 = no pings (30000)\n"
+		"  --duration <s>           stop after this time, 0 = until Ctrl+C (60)\n"
+		"  --report <s>             report interval (5)\n", program);
+}
+
+static void Report(BotStats const& stats, double seconds, uint64 packetsSent, uint64 packetsReceived, double bytesReceived)
+{
+	printf("[%7.1fs] connecting %u, queued %u, authed %u, in world %u, failed %u, dropped %u\n", seconds,
+		stats.connecting.load(), stats.queued.load(), stats.authed.load(), stats.inWorld.load(),
+		stats.failed.load(), stats.disconnected.load());
+	printf("           sent %llu pkt/s, received %llu pkt/s %.1f KiB/s\n",
+		(unsigned long long)packetsSent, (unsigned long long)packetsReceived, bytesReceived / 1024.0);
+}
+
+static void Summary(BotStats const& stats)
+{
+	printf("auth connect %s\n", stats.authConnect.Summary().c_str());
+	printf("connect      %s\n", stats.connect.Summary().c_str());
+	printf("handshake    %s\n", stats.handshake.Summary().c_str());
+	printf("char enum    %s\n", stats.charEnum.Summary().c_str());
+	printf("login        %s\n", stats.login.Summary().c_str());
+	printf("rtt          %s\n", stats.rtt.Summary().c_str());
+	printf("totals: sent %llu packets (%llu moves, %llu bytes), received %llu packets (%llu bytes)\n",
+		(unsigned long long)stats.packetsSent.load(), (unsigned long long)stats.movesSent.load(),
+		(unsigned long long)stats.bytesSent.load(), (unsigned long long)stats.packetsReceived.load(),
+		(unsigned long long)stats.bytesReceived.load());
+}
+
+int main(int argc, char** argv)
+{
+	BotConfig config;
+	config.host = "127.0.0.1";
+	config.port = 8085;
+	config.authPort = 0;
+	config.accountPrefix = "bot";
+	config.accountOffset = 0;
+	config.password = "bot";
+	config.build = 1499;
+	config.moveInterval = 500;
+	config.pingInterval = 30000;
+	config.moveRadius = 10.0f;
+
+	uint32 clients = 100;
+	uint32 ramp = 50;
+	uint32 threads = std::max(1u, std::thread::hardware_concurrency());
+	uint32 duration = 60;
+	uint32 reportInterval = 5;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		char const* arg = argv[i];
+		char const* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!strcmp(arg, "--help") || !value)
+		{
+			Usage(argv[0]);
+			return strcmp(arg, "--help") ? 1 : 0;
+		}
+		++i;
+
+		if (!strcmp(arg, "--host"))
+			config.host = value;
+		else if (!strcmp(arg, "--port"))
+			config.port = uint16(atoi(value));
+		else if (!strcmp(arg, "--auth"))
+		{
+			char const* colon = strrchr(value, ':');
+			if (!colon)
+			{
+				Usage(argv[0]);
+				return 1;
+			}
+			config.authHost.assign(value, colon);
+			config.authPort = uint16(atoi(colon + 1));
+		}
+		else if (!strcmp(arg, "--clients"))
+			clients = uint32(atoi(value));
+		else if (!strcmp(arg, "--ramp"))
+			ramp = uint32(atoi(value));
+		else if (!strcmp(arg, "--threads"))
+			threads = std::max(1, atoi(value));
+		else if (!strcmp(arg, "--account"))
+			config.accountPrefix = value;
+		else if (!strcmp(arg, "--offset"))
+			config.accountOffset = uint32(atoi(value));
+		else if (!strcmp(arg, "--password"))
+			config.password = value;
+		else if (!strcmp(arg, "--build"))
+			config.build = uint32(atoi(value));
+		else if (!strcmp(arg, "--move-interval"))
+			config.moveInterval = uint32(atoi(value));
+		else if (!strcmp(arg, "--move-radius"))
+			config.moveRadius = float(atof(value));
+		else if (!strcmp(arg, "--ping-interval"))
+			config.pingInterval = uint32(atoi(value));
+		else if (!strcmp(arg, "--duration"))
+			duration = uint32(atoi(value));
+		else if (!strcmp(arg, "--report"))
+			reportInterval = std::max(1, atoi(value));
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	BotStats stats;
+
+	// one io_service per thread like the server's NetworkThread, a bot stays on its service
+	std::vector<std::unique_ptr<boost::asio::io_service>> services;
+	std::vector<std::unique_ptr<boost::asio::io_service::work>> works;
+	std::vector<std::thread> workers;
+	for (uint32 i = 0; i < threads; ++i)
+	{
+		services.emplace_back(new boost::asio::io_service());
+		works.emplace_back(new boost::asio::io_service::work(*services.back()));
+	}
+	for (uint32 i = 0; i < threads; ++i)
+	{
+		boost::asio::io_service* service = services[i].get();
+		workers.emplace_back([service] { service->run(); });
+	}
+
+	printf("Starting %u bots against %s:%u on %u threads\n", clients, config.host.c_str(), config.port, threads);
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point const start = Clock::now();
+	Clock::time_point nextReport = start + std::chrono::seconds(reportInterval);
+
+	std::vector<std::shared_ptr<Bot>> bots;
+	bots.reserve(clients);
+
+	uint64 lastPacketsSent = 0, lastPacketsReceived = 0, lastBytesReceived = 0;
+	while (!s_stop)
+	{
+		Clock::time_point now = Clock::now();
+		double elapsed = std::chrono::duration<double>(now - start).count();
+
+		// start the bots due by now
+		uint32 due = ramp ? std::min<uint32>(clients, uint32(elapsed * ramp) + 1) : clients;
+		while (bots.size() < due)
+		{
+			boost::asio::io_service& service = *services[bots.size() % threads];
+			std::shared_ptr<Bot> bot = std::make_shared<Bot>(service, config, stats, uint32(bots.size()));
+			service.post([bot] { bot->Start(); });
+			bots.push_back(bot);
+		}
+
+		if (now >= nextReport)
+		{
+			uint64 packetsSent = stats.packetsSent.load(), packetsReceived = stats.packetsReceived.load(), bytesReceived = stats.bytesReceived.load();
+			Report(stats, elapsed, (packetsSent - lastPacketsSent) / reportInterval,
+				(packetsReceived - lastPacketsReceived) / reportInterval, double(bytesReceived - lastBytesReceived) / reportInterval);
+			lastPacketsSent = packetsSent;
+			lastPacketsReceived = packetsReceived;
+			lastBytesReceived = bytesReceived;
+			nextReport += std::chrono::seconds(reportInterval);
+		}
+
+		if (duration && elapsed >= duration)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	for (size_t i = 0; i < bots.size(); ++i)
+	{
+		std::shared_ptr<Bot> bot = bots[i];
+		services[i % threads]->post([bot] { bot->Stop(); });
+	}
+	works.clear();
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+
+	Summary(stats);
+	return 0;
+}
@@ -182,6 +182,16 @@ void Database::ProcessResultQueue()
 		m_pResultQueue->Update();
 }
 
+size_t Database::GetDelayQueueSize() const
+{
+	return m_threadBody ? m_threadBody->GetQueueSize() : 0;
+}
+
+size_t Database::GetResultQueueSize() const
+{
+	return m_pResultQueue ? m_pResultQueue->GetSize() : 0;
+}
+
 void Database::escape_string(std::string& str)
 {
 	if (str.empty())
@@ -285,6 +295,42 @@ QueryResult* Database::PQuery(const char* format, ...)
 	return Query(szQuery);
 }
 
+SqlQueryAwaiter Database::AwaitPQuery(const char* format, ...)
+{
+	if (!format || !m_pResultQueue)
+		return SqlQueryAwaiter(this, nullptr);
+
+	va_list ap;
+	char szQuery[MAX_QUERY_LEN];
+	va_start(ap, format);
+	int res = vsnprintf(szQuery, MAX_QUERY_LEN, format, ap);
+	va_end(ap);
+
+	if (res == -1)
+	{
+		sLog.outErrorDb("SQL Query truncated (and not execute) for format: %s", format);
+		return SqlQueryAwaiter(this, nullptr);
+	}
+
+	return SqlQueryAwaiter(this, szQuery);
+}
+
+bool Database::DelayAwaitedQuery(const char* sql, QueryResult** result, SqlResumption const& resumption)
+{
+	if (!sql || !m_pResultQueue)
+		return false;
+
+	return m_threadBody->Delay(new SqlAwaitedQuery(sql, result, resumption, m_pResultQueue));
+}
+
+bool Database::DelayAwaitedHolder(SqlQueryHolder* holder, SqlResumption const& resumption)
+{
+	if (!holder || !m_pResultQueue)
+		return false;
+
+	return m_threadBody->Delay(new SqlAwaitedHolder(holder, resumption, m_pResultQueue));
+}
+
 QueryNamedResult* Database::PQueryNamed(const char* format, ...)
 {
 	if (!format) return nullptr;
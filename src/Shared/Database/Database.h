@@ -6,6 +6,7 @@
 #include "SqlDelayThread.h"
 #include "../Config/ThreadingModel.h"
 #include "SqlPreparedStatement.h"
+#include "SqlAwaiter.h"
 
 #include <boost/thread/tss.hpp>
 #include <atomic>
@@ -159,6 +160,15 @@ public:
 	template<class Class, typename ParamType1>
 	bool DelayQueryHolder(Class* object, void (Class::*method)(QueryResult*, SqlQueryHolder*, ParamType1), SqlQueryHolder* holder, ParamType1 param1);
 
+	/// Async queries for coroutines: co_await suspends until the result is in, the coroutine continues in ProcessResultQueue
+	SqlQueryAwaiter AwaitQuery(const char* sql) { return SqlQueryAwaiter(this, m_pResultQueue ? sql : nullptr); }
+	SqlQueryAwaiter AwaitPQuery(const char* format, ...) ATTR_PRINTF(2, 3);
+	SqlHolderAwaiter AwaitQueryHolder(SqlQueryHolder* holder) { return SqlHolderAwaiter(this, m_pResultQueue ? holder : nullptr); }
+
+	// used by the awaiters
+	bool DelayAwaitedQuery(const char* sql, QueryResult** result, SqlResumption const& resumption);
+	bool DelayAwaitedHolder(SqlQueryHolder* holder, SqlResumption const& resumption);
+
 	bool Execute(const char* sql);
 	bool PExecute(const char* format, ...) ATTR_PRINTF(2, 3);
 
@@ -191,6 +201,10 @@ public:
 	// set database-wide result queue. also we should use object-bases and not thread-based result queues
 	void ProcessResultQueue();
 
+	// statements waiting for the delay thread, and results waiting for ProcessResultQueue
+	size_t GetDelayQueueSize() const;
+	size_t GetResultQueueSize() const;
+
 	bool CheckRequiredField(char const* table_name, char const* required_name);
 	uint32 GetPingIntervall() { return m_pingIntervallms; }
 
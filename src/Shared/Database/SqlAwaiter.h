@@ -0,0 +1,104 @@
+#ifndef __SQLAWAITER_H
+#define __SQLAWAITER_H
+
+#include "../Common.h"
+
+#include <coroutine>
+#include <vector>
+
+class Database;
+class QueryResult;
+class SqlQueryHolder;
+
+/// Continuation of a coroutine suspended on an async query, queued in the SqlResultQueue once the query ran.
+/// No allocation: it is the coroutine frame plus a function instantiated for the coroutine's promise type.
+class SqlResumption
+{
+public:
+	template<class Promise>
+	explicit SqlResumption(std::coroutine_handle<Promise> handle) : m_frame(handle.address()), m_resume(&Resume<Promise>) {}
+
+	/// Continue the coroutine, or destroy it when its promise says it must not run anymore
+	void Resume() const { m_resume(m_frame, false); }
+	/// Destroy the coroutine without running it, for results which are never processed
+	void Cancel() const { m_resume(m_frame, true); }
+
+private:
+	template<class Promise>
+	static void Resume(void* frame, bool cancel)
+	{
+		std::coroutine_handle<Promise> handle = std::coroutine_handle<Promise>::from_address(frame);
+
+		// a promise can refuse to continue, e.g. the session which started it is gone
+		if constexpr (requires(Promise& promise) { promise.CanResume(); })
+		{
+			if (!cancel && !handle.promise().CanResume())
+				cancel = true;
+		}
+
+		if (cancel)
+			handle.destroy();
+		else
+			handle.resume();
+	}
+
+	void* m_frame;
+	void (*m_resume)(void* frame, bool cancel);
+};
+
+/// co_await Database::AwaitQuery / AwaitPQuery, yields the QueryResult (nullptr if empty or failed), the caller must delete it.
+/// The coroutine continues in Database::ProcessResultQueue.
+class SqlQueryAwaiter
+{
+public:
+	SqlQueryAwaiter(Database* db, char const* sql);
+	~SqlQueryAwaiter();
+
+	SqlQueryAwaiter(SqlQueryAwaiter const&) = delete;
+	SqlQueryAwaiter& operator=(SqlQueryAwaiter const&) = delete;
+
+	bool await_ready() const { return m_sql.empty(); }
+
+	template<class Promise>
+	bool await_suspend(std::coroutine_handle<Promise> handle) { return Delay(SqlResumption(handle)); }
+
+	QueryResult* await_resume()
+	{
+		QueryResult* result = m_result;
+		m_result = nullptr;
+		return result;
+	}
+
+private:
+	bool Delay(SqlResumption const& resumption);
+
+	Database* const m_db;
+	std::vector<char> m_sql;                                // read by the delay thread, lives in the coroutine frame until it continues
+	QueryResult* m_result;
+};
+
+/// co_await Database::AwaitQueryHolder, yields false if the holder could not be queued.
+/// The holder stays owned by the caller and must outlive the co_await.
+class SqlHolderAwaiter
+{
+public:
+	SqlHolderAwaiter(Database* db, SqlQueryHolder* holder) : m_db(db), m_holder(holder), m_executed(false) {}
+
+	SqlHolderAwaiter(SqlHolderAwaiter const&) = delete;
+	SqlHolderAwaiter& operator=(SqlHolderAwaiter const&) = delete;
+
+	bool await_ready() const { return !m_holder; }
+
+	template<class Promise>
+	bool await_suspend(std::coroutine_handle<Promise> handle) { return Delay(SqlResumption(handle)); }
+
+	bool await_resume() const { return m_executed; }
+
+private:
+	bool Delay(SqlResumption const& resumption);
+
+	Database* const m_db;
+	SqlQueryHolder* const m_holder;
+	bool m_executed;
+};
+#endif                                                      //__SQLAWAITER_H
@@ -36,6 +36,13 @@ public:
 		return true;
 	}
 
+	///< Number of statements waiting to be executed
+	size_t GetQueueSize()
+	{
+		std::lock_guard<std::mutex> guard(m_queueMutex);
+		return m_sqlQueue.size();
+	}
+
 	virtual void Stop();                                ///< Stop event
 	virtual void run();                                 ///< Main Thread loop
 };
@@ -80,16 +80,50 @@ bool SqlQuery::Execute(SqlConnection* conn)
 	return true;
 }
 
+bool SqlAwaitedQuery::Execute(SqlConnection* conn)
+{
+	{
+		LOCK_DB_CONN(conn);
+		*m_result = conn->Query(m_sql);
+	}
+
+	/// the coroutine continues when the caller processes its result queue
+	m_queue->Add(m_resumption);
+	return true;
+}
+
+SqlResultQueue::~SqlResultQueue()
+{
+	/// coroutines whose results arrived too late are only destroyed
+	while (!m_resumptions.empty())
+	{
+		m_resumptions.front().Cancel();
+		m_resumptions.pop();
+	}
+}
+
 void SqlResultQueue::Update()
 {
-	std::lock_guard<std::mutex> guard(m_mutex);
+	std::queue<SqlResumption> resumptions;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
 
-	/// execute the callbacks waiting in the synchronization queue
-	while (!m_queue.empty())
+		/// execute the callbacks waiting in the synchronization queue
+		while (!m_queue.empty())
+		{
+			auto const callback = std::move(m_queue.front());
+			m_queue.pop();
+			callback->Execute();
+		}
+
+		resumptions.swap(m_resumptions);
+	}
+
+	/// continue the coroutines outside of the lock, they may queue their next query right away
+	while (!resumptions.empty())
 	{
-		auto const callback = std::move(m_queue.front());
-		m_queue.pop();
-		callback->Execute();
+		resumptions.front().Resume();
+		resumptions.pop();
 	}
 }
 
@@ -99,6 +133,18 @@ void SqlResultQueue::Add(Origin::IQueryCallback *callback)
 	m_queue.push(std::unique_ptr<Origin::IQueryCallback>(callback));
 }
 
+void SqlResultQueue::Add(SqlResumption const& resumption)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_resumptions.push(resumption);
+}
+
+size_t SqlResultQueue::GetSize()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_queue.size() + m_resumptions.size();
+}
+
 bool SqlQueryHolder::Execute(Origin::IQueryCallback* callback, SqlDelayThread* thread, SqlResultQueue* queue)
 {
 	if (!callback || !thread || !queue)
@@ -203,18 +249,59 @@ bool SqlQueryHolderEx::Execute(SqlConnection* conn)
 	if (!m_holder || !m_callback || !m_queue)
 		return false;
 
-	LOCK_DB_CONN(conn);
 	/// we can do this, we are friends
-	std::vector<SqlQueryHolder::SqlResultPair>& queries = m_holder->m_queries;
-	for (size_t i = 0; i < queries.size(); ++i)
-	{
-		/// execute all queries in the holder and pass the results
-		char const* sql = queries[i].first;
-		if (sql) m_holder->SetResult(i, conn->Query(sql));
-	}
+	m_holder->QueryAll(conn);
 
 	/// sync with the caller thread
 	m_queue->Add(m_callback);
 
 	return true;
 }
+
+bool SqlAwaitedHolder::Execute(SqlConnection* conn)
+{
+	m_holder->QueryAll(conn);
+
+	/// the coroutine continues when the caller processes its result queue
+	m_queue->Add(m_resumption);
+	return true;
+}
+
+void SqlQueryHolder::QueryAll(SqlConnection* conn)
+{
+	LOCK_DB_CONN(conn);
+	for (size_t i = 0; i < m_queries.size(); ++i)
+	{
+		/// execute all queries in the holder and pass the results
+		char const* sql = m_queries[i].first;
+		if (sql) SetResult(i, conn->Query(sql));
+	}
+}
+
+/// ---- COROUTINE AWAITERS ----
+
+SqlQueryAwaiter::SqlQueryAwaiter(Database* db, char const* sql) : m_db(db), m_result(nullptr)
+{
+	if (sql)
+		m_sql.assign(sql, sql + strlen(sql) + 1);
+}
+
+SqlQueryAwaiter::~SqlQueryAwaiter()
+{
+	/// not taken when the coroutine was destroyed while waiting
+	delete m_result;
+}
+
+bool SqlQueryAwaiter::Delay(SqlResumption const& resumption)
+{
+	return m_db->DelayAwaitedQuery(&m_sql[0], &m_result, resumption);
+}
+
+bool SqlHolderAwaiter::Delay(SqlResumption const& resumption)
+{
+	// set before queueing, the coroutine may continue as soon as the holder is queued
+	m_executed = true;
+	if (!m_db->DelayAwaitedHolder(m_holder, resumption))
+		m_executed = false;
+	return m_executed;
+}
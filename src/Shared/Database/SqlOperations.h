@@ -3,6 +3,7 @@
 
 #include "../Common.h"
 #include "../Util/Callback.h"
+#include "SqlAwaiter.h"
 
 #include <queue>
 #include <vector>
@@ -75,10 +76,17 @@ class SqlResultQueue
 private:
 	std::mutex m_mutex;
 	std::queue<std::unique_ptr<Origin::IQueryCallback>> m_queue;
+	std::queue<SqlResumption> m_resumptions;
 
 public:
+	~SqlResultQueue();
+
 	void Update();
 	void Add(Origin::IQueryCallback *);
+	void Add(SqlResumption const& resumption);
+
+	/// callbacks and coroutines waiting for the next Update
+	size_t GetSize();
 };
 
 class SqlQuery : public SqlOperation
@@ -98,12 +106,31 @@ public:
 	bool Execute(SqlConnection* conn) override;
 };
 
+/// Single async query of a suspended coroutine, the result is written straight into its SqlQueryAwaiter
+class SqlAwaitedQuery : public SqlOperation
+{
+private:
+	const char* m_sql;                                      // owned by the awaiter
+	QueryResult** const m_result;
+	SqlResumption const m_resumption;
+	SqlResultQueue* const m_queue;
+
+public:
+	SqlAwaitedQuery(const char* sql, QueryResult** result, SqlResumption const& resumption, SqlResultQueue* queue)
+		: m_sql(sql), m_result(result), m_resumption(resumption), m_queue(queue) {}
+
+	bool Execute(SqlConnection* conn) override;
+};
+
 class SqlQueryHolder
 {
 	friend class SqlQueryHolderEx;
+	friend class SqlAwaitedHolder;
 private:
 	typedef std::pair<const char*, QueryResult*> SqlResultPair;
 	std::vector<SqlResultPair> m_queries;
+
+	void QueryAll(SqlConnection* conn);
 public:
 	SqlQueryHolder() {}
 	~SqlQueryHolder();
@@ -126,4 +153,19 @@ public:
 		: m_holder(holder), m_callback(callback), m_queue(queue) {}
 	bool Execute(SqlConnection* conn) override;
 };
+
+/// Query holder of a suspended coroutine
+class SqlAwaitedHolder : public SqlOperation
+{
+private:
+	SqlQueryHolder* const m_holder;
+	SqlResumption const m_resumption;
+	SqlResultQueue* const m_queue;
+
+public:
+	SqlAwaitedHolder(SqlQueryHolder* holder, SqlResumption const& resumption, SqlResultQueue* queue)
+		: m_holder(holder), m_resumption(resumption), m_queue(queue) {}
+
+	bool Execute(SqlConnection* conn) override;
+};
 #endif                                                      //__SQLOPERATIONS_H
@@ -3,6 +3,7 @@
 #include "../Config/Singleton.h"
 #include "../Config/Config.h"
 #include "../Util/Util.h"
+#include "../Util/GameClock.h"
 
 #include <fstream>
 #include <iostream>
@@ -292,28 +293,18 @@ FILE* Log::openGmlogPerAccount(uint32 account)
 
 void Log::outTimestamp(FILE* file)
 {
-	time_t t = time(nullptr);
-	tm* aTm = localtime(&t);
-	//       YYYY   year
-	//       MM     month (2 digits 01-12)
-	//       DD     day (2 digits 01-31)
-	//       HH     hour (2 digits 00-23)
-	//       MM     minutes (2 digits 00-59)
-	//       SS     seconds (2 digits 00-59)
-	fprintf(file, "%-4d-%02d-%02d %02d:%02d:%02d ", aTm->tm_year + 1900, aTm->tm_mon + 1, aTm->tm_mday, aTm->tm_hour, aTm->tm_min, aTm->tm_sec);
+	// YYYY-MM-DD HH:MM:SS, formatted once per second by the world tick unless it stalls
+	char timestamp[GAMECLOCK_TIMESTAMP_LEN];
+	GameClock::GetTimestamp(timestamp);
+	fprintf(file, "%s ", timestamp);
 }
 
 void Log::outTime()
 {
-	time_t t = time(nullptr);
-	tm* aTm = localtime(&t);
-	//       YYYY   year
-	//       MM     month (2 digits 01-12)
-	//       DD     day (2 digits 01-31)
-	//       HH     hour (2 digits 00-23)
-	//       MM     minutes (2 digits 00-59)
-	//       SS     seconds (2 digits 00-59)
-	printf("%02d:%02d:%02d ", aTm->tm_hour, aTm->tm_min, aTm->tm_sec);
+	// HH:MM:SS part of the cached timestamp
+	char timestamp[GAMECLOCK_TIMESTAMP_LEN];
+	GameClock::GetTimestamp(timestamp);
+	printf("%s ", &timestamp[11]);
 }
 
 std::string Log::GetTimestampStr()
@@ -11,6 +11,7 @@
 #include <asio.hpp>
 
 #include "Scoket.h"
+#include "../Util/Watchdog.h"
 
 namespace Origin
 {
@@ -31,6 +32,11 @@ namespace Origin
 		// note that the work member *must* be declared after the service member for the work constructor to function correctly
 		boost::asio::io_service::work m_work;
 
+		// socket timeouts, only touched by the service thread
+		TimerWheel m_timerWheel;
+		boost::asio::steady_timer m_timerWheelTimer;
+		std::chrono::steady_clock::time_point m_timerWheelStart;
+
 		std::mutex m_closingSocketLock;
 		std::list<std::unique_ptr<SocketType>> m_closingSockets;
 
@@ -41,12 +47,22 @@ namespace Origin
 
 		void SocketCleanupWork();
 
+		void StartTimerWheelTimer();
+		void OnTimerWheelTimer(const boost::system::error_code &error);
+
 	public:
-		NetworkThread() : m_work(m_service), m_pendingShutdown(false),
-			m_serviceThread([this] { boost::system::error_code ec; this->m_service.run(ec); }),
+		NetworkThread() : m_work(m_service), m_timerWheelTimer(m_service), m_timerWheelStart(std::chrono::steady_clock::now()), m_pendingShutdown(false),
+			m_serviceThread([this]
+			{
+				Watchdog::RegisterThread("Network", WATCHDOG_THREAD_NETWORK);
+				boost::system::error_code ec;
+				this->m_service.run(ec);
+				Watchdog::UnregisterThread();
+			}),
 			m_socketCleanupThread([this] { this->SocketCleanupWork(); })
 		{
 			m_serviceThread.detach();
+			StartTimerWheelTimer();
 		}
 
 		~NetworkThread()
@@ -62,6 +78,7 @@ namespace Origin
 			}
 
 			m_pendingShutdown = true;
+			m_timerWheelTimer.cancel();
 			m_socketCleanupThread.join();
 		}
 
@@ -112,9 +129,34 @@ namespace Origin
 		std::lock_guard<std::mutex> guard(m_socketLock);
 
 		m_sockets.push_front(std::unique_ptr<SocketType>(new SocketType(m_service, [this](Socket *socket) { this->RemoveSocket(socket); })));
+		m_sockets.front()->SetTimerWheel(&m_timerWheel);
 
 		return m_sockets.begin()->get();
 	}
+
+	template <typename SocketType>
+	void NetworkThread<SocketType>::StartTimerWheelTimer()
+	{
+		m_timerWheelTimer.expires_after(std::chrono::milliseconds(Socket::TimeoutTick));
+		m_timerWheelTimer.async_wait([this](const boost::system::error_code &error) { this->OnTimerWheelTimer(error); });
+	}
+
+	template <typename SocketType>
+	void NetworkThread<SocketType>::OnTimerWheelTimer(const boost::system::error_code &error)
+	{
+		if (error || m_pendingShutdown)
+			return;
+
+		// catch up on ticks a busy service thread missed, the wheel follows the clock rather than the timer
+		const uint64 now = uint64(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_timerWheelStart).count()) / Socket::TimeoutTick;
+		if (now > m_timerWheel.GetTime())
+		{
+			WatchdogPhase phase("NetworkThread::TimerWheel");
+			m_timerWheel.Advance(now - m_timerWheel.GetTime());
+		}
+
+		StartTimerWheelTimer();
+	}
 }
 
 #endif /* !__NETWORK_THREAD_H_ */
\ No newline at end of file
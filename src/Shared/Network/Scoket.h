@@ -19,6 +19,8 @@
 #ifndef __SOCKET_H_
 #define __SOCKET_H_
 
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <string>
 #include <mutex>
@@ -29,9 +31,20 @@
 #include "../Define.h"
 
 #include "PacketBuffer.h"
+#include "TimerWheel.h"
 
 namespace Origin
 {
+	/// Totals over all sockets
+	struct SocketStats
+	{
+		std::atomic<uint32> openSockets;
+		std::atomic<uint64> bytesReceived;
+		std::atomic<uint64> bytesSent;
+		std::atomic<int64> bytesQueued;                     // written to the out buffers, not sent yet
+		std::atomic<uint64> timedOut;                       // closed by their network thread's timer wheel
+	};
+
 	class Socket
 	{
 	private:
@@ -39,6 +52,9 @@ namespace Origin
 		// ingame but increase bandwidth efficiency by reducing tcp overhead.
 		static const int BufferTimeout = 50;
 
+		// most bulk lane bytes put into one send, a realtime packet never waits behind more than this
+		static const size_t BulkChunkSize = 16384;
+
 		enum class WriteState
 		{
 			Idle,       // no write operation is currently underway
@@ -60,21 +76,37 @@ namespace Origin
 		std::function<void(Socket *)> m_closeHandler;
 
 		std::unique_ptr<PacketBuffer> m_inBuffer;
-		std::unique_ptr<PacketBuffer> m_outBuffer;
-		std::unique_ptr<PacketBuffer> m_secondaryOutBuffer;
+		std::unique_ptr<PacketBuffer> m_outBuffer;          // handed to the socket, ends at a packet boundary
+		std::unique_ptr<PacketBuffer> m_realtimeOutBuffer;  // waiting, moved to m_outBuffer as a whole
+		std::unique_ptr<PacketBuffer> m_bulkOutBuffer;      // waiting, moved to m_outBuffer in chunks of whole packets
+		std::deque<uint32> m_bulkPacketSizes;
 
 		std::mutex m_mutex;
 		boost::asio::deadline_timer m_outBufferFlushTimer;
 
+		/// Timeout check of this socket, on the wheel of the network thread owning it
+		TimerWheel* m_timerWheel;
+		TimerWheel::Node m_timeoutNode;
+		// the socket is not deleted while the node is linked or a timeout update is posted to the network thread
+		std::atomic<bool> m_timeoutScheduled;
+		std::atomic<uint32> m_timeoutPosts;
+		uint64 m_openTime;
+		uint64 m_lastReadTime;
+
+		static SocketStats m_stats;
+
 		void StartAsyncRead();
 		void OnRead(const boost::system::error_code &error, size_t length);
 
 		void StartWriteFlushTimer();
+		void FillOutBuffer();
 		void OnWriteComplete(const boost::system::error_code &error, size_t length);
 		void FlushOut();
 
 		void OnError(const boost::system::error_code &error);
 
+		void OnTimeout();
+
 	protected:
 		const std::string m_address;
 		const std::string m_remoteEndpoint;
@@ -87,25 +119,55 @@ namespace Origin
 
 		void ForceFlushOut();
 
+		/// Wheel tick at which the socket times out, 0 for never. Called on the network thread, a socket which
+		/// was active meanwhile just answers a later tick, so reads never touch the wheel.
+		virtual uint64 GetTimeoutDeadline() const { return 0; }
+
+		/// (Re)arm the timeout at GetTimeoutDeadline(), needed only when the deadline moves earlier. Network thread only.
+		void UpdateTimeout();
+
+		/// Network thread wheel time, in TimeoutTick milliseconds
+		uint64 GetTime() const { return m_timerWheel ? m_timerWheel->GetTime() : 0; }
+		uint64 GetOpenTime() const { return m_openTime; }
+		uint64 GetLastReadTime() const { return m_lastReadTime; }
+
 	public:
+		// milliseconds per tick of the network threads' timer wheels, socket timeouts are as precise as this
+		static const int TimeoutTick = 1000;
+
+		/// Every send takes what is left of the previous one, then the whole realtime lane, then at most
+		/// BulkChunkSize of the bulk lane. Each lane keeps its own order, packets are never split between lanes.
+		enum class SendLane
+		{
+			Realtime,   // small and latency critical, pongs and movement
+			Bulk,       // everything else
+		};
+
 		Socket(boost::asio::io_service &service, std::function<void(Socket *)> closeHandler);
-		virtual ~Socket() { assert(Deletable()); }
+		virtual ~Socket();
 
 		virtual bool Open();
 		void Close();
 
 		bool IsClosed() const { return !m_socket.is_open(); }
-		virtual bool Deletable() const { return IsClosed(); }
+		virtual bool Deletable() const { return IsClosed() && !m_timeoutScheduled && !m_timeoutPosts; }
+
+		/// Set by the owning NetworkThread before the socket is opened
+		void SetTimerWheel(TimerWheel* wheel) { m_timerWheel = wheel; }
 
 		bool Read(char *buffer, int length);
 		void ReadSkip(int length) { m_inBuffer->Read(nullptr, length); }
 
-		void Write(const char *buffer, int length);
+		/// Queue one packet (a header and an optional body) as a unit
+		void Write(const char *buffer, int length, SendLane lane = SendLane::Bulk) { Write(buffer, length, nullptr, 0, lane); }
+		void Write(const char *header, int headerLength, const char *body, int bodyLength, SendLane lane);
 
 		boost::asio::ip::tcp::socket &GetAsioSocket() { return m_socket; }
 
 		const std::string &GetRemoteEndpoint() const { return m_remoteEndpoint; }
 		const std::string &GetRemoteAddress() const { return m_address; }
+
+		static SocketStats const& GetStats() { return m_stats; }
 	};
 }
 
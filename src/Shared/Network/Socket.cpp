@@ -1,4 +1,5 @@
 #include <string>
+#include <cstring>
 #include <memory>
 #include <vector>
 #include <functional>
@@ -9,16 +10,34 @@
 
 #include "Scoket.h"
 #include "../Log/Log.h"
+#include "../Util/Watchdog.h"
 
 
 using namespace Origin;
 
+SocketStats Socket::m_stats;
+
 Socket::Socket(boost::asio::io_service &service, std::function<void(Socket *)> closeHandler)
 	: m_socket(service), m_address("0.0.0.0"), m_outBufferFlushTimer(service),
-	m_closeHandler(closeHandler), m_writeState(WriteState::Idle), m_readState(ReadState::Idle) {}
+	m_closeHandler(closeHandler), m_writeState(WriteState::Idle), m_readState(ReadState::Idle),
+	m_timerWheel(nullptr), m_timeoutNode([this] { this->OnTimeout(); }), m_timeoutScheduled(false), m_timeoutPosts(0),
+	m_openTime(0), m_lastReadTime(0) {}
+
+Socket::~Socket()
+{
+	assert(Deletable());
+
+	// never sent, do not leave it counted
+	if (m_outBuffer)
+		m_stats.bytesQueued -= int64(m_outBuffer->m_writePosition + m_realtimeOutBuffer->m_writePosition +
+			m_bulkOutBuffer->ReadLengthRemaining());
+}
 
 bool Socket::Open()
 {
+	// the accepted connection is open even if the rest fails, Close() takes it off again
+	++m_stats.openSockets;
+
 	try
 	{
 		const_cast<std::string &>(m_address) = m_socket.remote_endpoint().address().to_string();
@@ -31,11 +50,24 @@ bool Socket::Open()
 	}
 
 	m_outBuffer.reset(new PacketBuffer);
-	m_secondaryOutBuffer.reset(new PacketBuffer);
+	m_realtimeOutBuffer.reset(new PacketBuffer);
+	m_bulkOutBuffer.reset(new PacketBuffer);
 	m_inBuffer.reset(new PacketBuffer);
 
 	StartAsyncRead();
 
+	// accepted on the listener thread, the timeout is armed on the network thread which owns the wheel
+	if (m_timerWheel)
+	{
+		++m_timeoutPosts;
+		boost::asio::post(m_socket.get_executor(), [this]
+		{
+			m_openTime = m_lastReadTime = GetTime();
+			UpdateTimeout();
+			--m_timeoutPosts;
+		});
+	}
+
 	return true;
 }
 
@@ -45,11 +77,58 @@ void Socket::Close()
 	boost::system::error_code ec;
 	m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
 	m_socket.close();
+	--m_stats.openSockets;
+
+	// Close() may come from any thread, take the timeout off the wheel on its own thread
+	if (m_timerWheel)
+	{
+		++m_timeoutPosts;
+		boost::asio::post(m_socket.get_executor(), [this]
+		{
+			UpdateTimeout();
+			--m_timeoutPosts;
+		});
+	}
 
 	if (m_closeHandler)
 		m_closeHandler(this);
 }
 
+void Socket::UpdateTimeout()
+{
+	if (!m_timerWheel)
+		return;
+
+	const uint64 deadline = IsClosed() ? 0 : GetTimeoutDeadline();
+	if (deadline)
+		m_timerWheel->Schedule(m_timeoutNode, deadline);
+	else
+		m_timerWheel->Cancel(m_timeoutNode);
+
+	m_timeoutScheduled = m_timeoutNode.IsScheduled();
+}
+
+void Socket::OnTimeout()
+{
+	// the node has just been taken off the wheel
+	m_timeoutScheduled = false;
+
+	if (!IsClosed())
+	{
+		const uint64 deadline = GetTimeoutDeadline();
+		if (deadline && deadline <= GetTime())
+		{
+			++m_stats.timedOut;
+			DETAIL_LOG("Socket::OnTimeout: connection from %s timed out", m_address.c_str());
+			Close();
+			return;
+		}
+	}
+
+	// still in time (it was active meanwhile), check again at the new deadline
+	UpdateTimeout();
+}
+
 void Socket::StartAsyncRead()
 {
 	if (IsClosed())
@@ -79,7 +158,11 @@ void Socket::OnRead(const boost::system::error_code &error, size_t length)
 		return;
 	}
 
+	WatchdogPhase phase("Socket::OnRead");
+
+	m_stats.bytesReceived += length;
 	m_inBuffer->m_writePosition += length;
+	m_lastReadTime = GetTime();
 
 	const size_t available = m_socket.available();
 
@@ -151,26 +234,57 @@ bool Socket::Read(char *buffer, int length)
 	return true;
 }
 
-void Socket::Write(const char *buffer, int length)
+void Socket::Write(const char *header, int headerLength, const char *body, int bodyLength, SendLane lane)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
-	switch (m_writeState)
-	{
-	case WriteState::Idle:
-		m_outBuffer->Write(buffer, length);
+	m_stats.bytesQueued += headerLength + bodyLength;
+
+	// the lanes are only moved to m_outBuffer when sending, so all states queue the same way
+	PacketBuffer &out = lane == SendLane::Realtime ? *m_realtimeOutBuffer : *m_bulkOutBuffer;
+	out.Write(header, headerLength);
+	if (bodyLength > 0)
+		out.Write(body, bodyLength);
+
+	if (lane == SendLane::Bulk)
+		m_bulkPacketSizes.push_back(uint32(headerLength + bodyLength));
+
+	if (m_writeState == WriteState::Idle)
 		StartWriteFlushTimer();
-		break;
+}
+
+// note that this function assumes that the socket mutex is locked
+void Socket::FillOutBuffer()
+{
+	// everything in the realtime lane first
+	if (m_realtimeOutBuffer->m_writePosition > 0)
+	{
+		m_outBuffer->Write(reinterpret_cast<const char *>(&m_realtimeOutBuffer->m_buffer[0]), int(m_realtimeOutBuffer->m_writePosition));
+		m_realtimeOutBuffer->m_writePosition = 0;
+	}
 
-	case WriteState::Buffering:
-		m_outBuffer->Write(buffer, length);
-		break;
+	// then whole bulk packets up to the chunk size, at least one even if it is larger
+	size_t chunk = 0;
+	while (!m_bulkPacketSizes.empty() && (!chunk || chunk + m_bulkPacketSizes.front() <= BulkChunkSize))
+	{
+		chunk += m_bulkPacketSizes.front();
+		m_bulkPacketSizes.pop_front();
+	}
+
+	if (!chunk)
+		return;
 
-	case WriteState::Sending:
-		m_secondaryOutBuffer->Write(buffer, length);
-		break;
+	m_outBuffer->Write(reinterpret_cast<const char *>(&m_bulkOutBuffer->m_buffer[m_bulkOutBuffer->m_readPosition]), int(chunk));
+	m_bulkOutBuffer->m_readPosition += chunk;
 
-	default:
-		assert(false);
+	// a zone-in burst is taken in many chunks, only move the rest to the front once that is a plain copy
+	const size_t remaining = m_bulkOutBuffer->m_writePosition - m_bulkOutBuffer->m_readPosition;
+	if (!remaining)
+		m_bulkOutBuffer->m_writePosition = m_bulkOutBuffer->m_readPosition = 0;
+	else if (m_bulkOutBuffer->m_readPosition >= remaining)
+	{
+		memcpy(&m_bulkOutBuffer->m_buffer[0], &m_bulkOutBuffer->m_buffer[m_bulkOutBuffer->m_readPosition], remaining);
+		m_bulkOutBuffer->m_readPosition = 0;
+		m_bulkOutBuffer->m_writePosition = remaining;
 	}
 }
 
@@ -206,7 +320,8 @@ void Socket::FlushOut()
 
 	assert(m_writeState == WriteState::Buffering);
 
-	// at this point we are guarunteed that there is data to send in the primary buffer.  send it.
+	// at this point we are guarunteed that there is data waiting in a lane.  send it.
+	FillOutBuffer();
 	m_writeState = WriteState::Sending;
 
 	m_socket.async_write_some(boost::asio::buffer(m_outBuffer->m_buffer, m_outBuffer->m_writePosition),
@@ -242,6 +357,9 @@ void Socket::OnWriteComplete(const boost::system::error_code &error, size_t leng
 	assert(m_writeState == WriteState::Sending);
 	assert(length <= m_outBuffer->m_writePosition);
 
+	m_stats.bytesSent += length;
+	m_stats.bytesQueued -= int64(length);
+
 	// if there is data left to write, move it to the start of the buffer
 	if (length < m_outBuffer->m_writePosition)
 	{
@@ -252,18 +370,8 @@ void Socket::OnWriteComplete(const boost::system::error_code &error, size_t leng
 	else
 		m_outBuffer->m_writePosition = 0;
 
-	// if there is data in the secondary buffer, append it to the primary buffer
-	if (m_secondaryOutBuffer->m_writePosition > 0)
-	{
-		// do we have enough space? if not, resize
-		if (m_outBuffer->m_buffer.size() < (m_outBuffer->m_writePosition + m_secondaryOutBuffer->m_writePosition))
-			m_outBuffer->m_buffer.resize(m_outBuffer->m_writePosition + m_secondaryOutBuffer->m_writePosition);
-
-		std::copy(&m_secondaryOutBuffer->m_buffer[0], &m_secondaryOutBuffer->m_buffer[m_secondaryOutBuffer->m_writePosition], &m_outBuffer->m_buffer[m_outBuffer->m_writePosition]);
-
-		m_outBuffer->m_writePosition += m_secondaryOutBuffer->m_writePosition;
-		m_secondaryOutBuffer->m_writePosition = 0;
-	}
+	// the rest of a partly sent packet has to go first, then the realtime lane overtakes the waiting bulk data
+	FillOutBuffer();
 
 	// if there is any data to write, do so immediately
 	if (m_outBuffer->m_writePosition > 0)
@@ -0,0 +1,173 @@
+#ifndef __TIMER_WHEEL_H_
+#define __TIMER_WHEEL_H_
+
+#include <functional>
+
+#include "../Define.h"
+
+namespace Origin
+{
+	/// Hierarchical timer wheel, as used by the network threads for socket timeouts.
+	/// Scheduling and cancelling are O(1), advancing one tick only touches the slots that are due.
+	/// Not thread safe, every wheel belongs to the thread which advances it.
+	class TimerWheel
+	{
+	public:
+		static const uint32 SlotBits = 6;
+		static const uint32 Slots = 1 << SlotBits;
+		static const uint32 SlotMask = Slots - 1;
+		// with a one second tick the last level covers about 190 days, longer timers are clamped to it
+		static const uint32 Levels = 4;
+
+		/// Intrusive timer, embedded in the object it times out
+		class Node
+		{
+			friend class TimerWheel;
+
+		public:
+			Node() : m_prev(nullptr), m_next(nullptr), m_expires(0) {}
+			explicit Node(std::function<void()> callback) : m_prev(nullptr), m_next(nullptr), m_expires(0), m_callback(std::move(callback)) {}
+			~Node() { Unlink(); }
+
+			Node(Node const&) = delete;
+			Node& operator=(Node const&) = delete;
+
+			void SetCallback(std::function<void()> callback) { m_callback = std::move(callback); }
+
+			bool IsScheduled() const { return m_prev != nullptr; }
+			/// tick the node fires at
+			uint64 GetExpires() const { return m_expires; }
+
+		private:
+			void Unlink()
+			{
+				if (!m_prev)
+					return;
+				m_prev->m_next = m_next;
+				m_next->m_prev = m_prev;
+				m_prev = m_next = nullptr;
+			}
+
+			void LinkBefore(Node& position)
+			{
+				m_prev = position.m_prev;
+				m_next = &position;
+				m_prev->m_next = this;
+				position.m_prev = this;
+			}
+
+			Node* m_prev;
+			Node* m_next;
+			uint64 m_expires;
+			std::function<void()> m_callback;
+		};
+
+		TimerWheel() : m_now(0)
+		{
+			for (uint32 level = 0; level < Levels; ++level)
+				for (uint32 slot = 0; slot < Slots; ++slot)
+					InitList(m_slots[level][slot]);
+		}
+
+		~TimerWheel()
+		{
+			// leave no node pointing into the wheel
+			for (uint32 level = 0; level < Levels; ++level)
+				for (uint32 slot = 0; slot < Slots; ++slot)
+					while (m_slots[level][slot].m_next != &m_slots[level][slot])
+						m_slots[level][slot].m_next->Unlink();
+		}
+
+		/// current tick
+		uint64 GetTime() const { return m_now; }
+
+		/// (Re)schedule node to fire at tick expires, a tick in the past fires at the next Advance
+		void Schedule(Node& node, uint64 expires)
+		{
+			node.Unlink();
+			node.m_expires = expires > m_now ? expires : m_now + 1;
+			Insert(node);
+		}
+
+		void Cancel(Node& node) { node.Unlink(); }
+
+		/// Move the wheel forward by ticks, firing every node which is due.
+		/// A callback may schedule or cancel any node, including its own.
+		void Advance(uint64 ticks)
+		{
+			while (ticks--)
+			{
+				++m_now;
+
+				// the lower level wrapped, spread the next slot of the level above over it
+				for (uint32 level = 1; level < Levels && !(m_now & ((uint64(1) << (level * SlotBits)) - 1)); ++level)
+					Cascade(level, (m_now >> (level * SlotBits)) & SlotMask);
+
+				Node& slot = m_slots[0][m_now & SlotMask];
+				if (slot.m_next == &slot)
+					continue;
+
+				// move the due nodes to a local list, so callbacks rescheduling into this slot are not fired again
+				Node due;
+				InitList(due);
+				Splice(slot, due);
+
+				while (due.m_next != &due)
+				{
+					Node* node = due.m_next;
+					node->Unlink();
+					if (node->m_callback)
+						node->m_callback();
+				}
+			}
+		}
+
+	private:
+		static void InitList(Node& head) { head.m_prev = head.m_next = &head; }
+
+		static void Splice(Node& from, Node& to)
+		{
+			if (from.m_next == &from)
+				return;
+			to.m_next = from.m_next;
+			to.m_prev = from.m_prev;
+			to.m_next->m_prev = &to;
+			to.m_prev->m_next = &to;
+			InitList(from);
+		}
+
+		void Insert(Node& node)
+		{
+			uint64 delta = node.m_expires - m_now;
+
+			uint32 level = 0;
+			while (level < Levels - 1 && delta >= (uint64(1) << ((level + 1) * SlotBits)))
+				++level;
+
+			uint64 expires = node.m_expires;
+			if (level == Levels - 1 && delta >= (uint64(1) << (Levels * SlotBits)))
+				expires = m_now + (uint64(1) << (Levels * SlotBits)) - 1;
+
+			node.LinkBefore(m_slots[level][(expires >> (level * SlotBits)) & SlotMask]);
+		}
+
+		void Cascade(uint32 level, uint64 slot)
+		{
+			Node pending;
+			InitList(pending);
+			Splice(m_slots[level][slot], pending);
+
+			while (pending.m_next != &pending)
+			{
+				Node* node = pending.m_next;
+				node->Unlink();
+				Insert(*node);
+			}
+		}
+
+		uint64 m_now;
+		Node m_slots[Levels][Slots];
+	};
+}
+
+#endif /* !__TIMER_WHEEL_H_ */
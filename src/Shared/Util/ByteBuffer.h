@@ -7,10 +7,10 @@
 class ByteBufferException
 {
 public:
+	// not logged here, the handler catching it decides (see ByteBuffer::try_read for parsing without exceptions)
 	ByteBufferException(bool _add, size_t _pos, size_t _esize, size_t _size)
 		: add(_add), pos(_pos), esize(_esize), size(_size)
 	{
-		PrintPosError();
 	}
 
 	void PrintPosError() const;
@@ -278,6 +278,83 @@ public:
 		_rpos += len;
 	}
 
+	// Non-throwing reads for packet parsing, a read past the end returns false and consumes nothing.
+	// Unlike the operators above they neither throw nor log, a malformed packet costs a compare.
+	template <typename T> bool try_read(T& value)
+	{
+		if (_rpos + sizeof(T) > size())
+			return false;
+		memcpy(&value, &_storage[_rpos], sizeof(T));
+		EndianConvert(value);
+		_rpos += sizeof(T);
+		return true;
+	}
+
+	bool try_read(bool& value)
+	{
+		uint8 byte;
+		if (!try_read(byte))
+			return false;
+		value = byte > 0;
+		return true;
+	}
+
+	// a string without terminator is malformed, not silently cut at the end of the packet
+	bool try_read(std::string& value)
+	{
+		if (_rpos >= size())
+			return false;
+		uint8 const* start = &_storage[_rpos];
+		uint8 const* end = (uint8 const*)memchr(start, 0, size() - _rpos);
+		if (!end)
+			return false;
+		value.assign((char const*)start, end - start);
+		_rpos += end - start + 1;
+		return true;
+	}
+
+	bool try_read(uint8* dest, size_t len)
+	{
+		if (_rpos + len > size())
+			return false;
+		if (len)
+			memcpy(dest, &_storage[_rpos], len);
+		_rpos += len;
+		return true;
+	}
+
+	bool try_read_skip(size_t skip)
+	{
+		if (_rpos + skip > size())
+			return false;
+		_rpos += skip;
+		return true;
+	}
+
+	bool try_readPackGUID(uint64& guid)
+	{
+		size_t start = _rpos;
+		uint8 guidmark;
+		if (!try_read(guidmark))
+			return false;
+
+		guid = 0;
+		for (int i = 0; i < 8; ++i)
+		{
+			if (guidmark & (uint8(1) << i))
+			{
+				uint8 bit;
+				if (!try_read(bit))
+				{
+					_rpos = start;
+					return false;
+				}
+				guid |= (uint64(bit) << (i * 8));
+			}
+		}
+		return true;
+	}
+
 	uint64 readPackGUID()
 	{
 		uint64 guid = 0;
@@ -403,6 +480,41 @@ protected:
 	std::vector<uint8> _storage;
 };
 
+/// Sticky non-throwing reader for packet handlers: reader >> a >> b; if (!reader) ...
+/// The first field past the end fails the reader, that and every later field is left value initialized,
+/// so a handler checks once after extracting everything.
+class PacketReader
+{
+public:
+	explicit PacketReader(ByteBuffer& buffer) : m_buffer(buffer), m_failed(false) {}
+
+	template<typename T>
+	PacketReader& operator>>(T& value)
+	{
+		if (m_failed || !m_buffer.try_read(value))
+		{
+			value = T();
+			m_failed = true;
+		}
+		return *this;
+	}
+
+	template<class T>
+	PacketReader& operator>>(Unused<T> const&)
+	{
+		if (!m_failed && !m_buffer.try_read_skip(sizeof(T)))
+			m_failed = true;
+		return *this;
+	}
+
+	bool Failed() const { return m_failed; }
+	explicit operator bool() const { return !m_failed; }
+
+private:
+	ByteBuffer& m_buffer;
+	bool m_failed;
+};
+
 template <typename T>
 inline ByteBuffer& operator<<(ByteBuffer& b, std::vector<T> const& v)
 {
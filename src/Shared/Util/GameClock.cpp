@@ -0,0 +1,60 @@
+#include "GameClock.h"
+#include "Timer.h"
+
+std::atomic<time_t> GameClock::m_gameTime(0);
+std::atomic<uint32> GameClock::m_msTime(0);
+
+char GameClock::m_timestamps[GAMECLOCK_TIMESTAMP_SLOTS][GAMECLOCK_TIMESTAMP_LEN];
+std::atomic<uint32> GameClock::m_timestampSlot(0);
+time_t GameClock::m_timestampTime = 0;
+
+void GameClock::Update()
+{
+	time_t now = time(nullptr);
+
+	m_msTime.store(WorldTimer::getMSTime(), std::memory_order_relaxed);
+
+	// localtime only once per second
+	if (now != m_timestampTime)
+	{
+		uint32 next = (m_timestampSlot.load(std::memory_order_relaxed) + 1) % GAMECLOCK_TIMESTAMP_SLOTS;
+		FormatTimestamp(now, m_timestamps[next]);
+		m_timestampSlot.store(next, std::memory_order_release);
+		m_timestampTime = now;
+	}
+
+	// published last, readers see a formatted timestamp as soon as they see a game time
+	m_gameTime.store(now, std::memory_order_release);
+}
+
+uint32 GameClock::GetMSTime()
+{
+	if (!m_gameTime.load(std::memory_order_acquire))
+		return WorldTimer::getMSTime();
+
+	return m_msTime.load(std::memory_order_relaxed);
+}
+
+void GameClock::GetTimestamp(char (&buf)[GAMECLOCK_TIMESTAMP_LEN])
+{
+	if (!m_gameTime.load(std::memory_order_acquire) ||
+		WorldTimer::getMSTimeDiff(m_msTime.load(std::memory_order_relaxed), WorldTimer::getMSTime()) >= GAMECLOCK_STALE_TIME)
+	{
+		FormatTimestamp(time(nullptr), buf);
+		return;
+	}
+
+	memcpy(buf, m_timestamps[m_timestampSlot.load(std::memory_order_acquire)], GAMECLOCK_TIMESTAMP_LEN);
+}
+
+void GameClock::FormatTimestamp(time_t t, char (&buf)[GAMECLOCK_TIMESTAMP_LEN])
+{
+	tm* aTm = localtime(&t);
+	//       YYYY   year
+	//       MM     month (2 digits 01-12)
+	//       DD     day (2 digits 01-31)
+	//       HH     hour (2 digits 00-23)
+	//       MM     minutes (2 digits 00-59)
+	//       SS     seconds (2 digits 00-59)
+	snprintf(buf, GAMECLOCK_TIMESTAMP_LEN, "%04d-%02d-%02d %02d:%02d:%02d", aTm->tm_year + 1900, aTm->tm_mon + 1, aTm->tm_mday, aTm->tm_hour, aTm->tm_min, aTm->tm_sec);
+}
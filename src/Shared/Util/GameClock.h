@@ -0,0 +1,48 @@
+#ifndef ORIGIN_GAMECLOCK_H
+#define ORIGIN_GAMECLOCK_H
+
+#include "../Common.h"
+
+#include <atomic>
+
+// "YYYY-MM-DD HH:MM:SS" plus terminator
+#define GAMECLOCK_TIMESTAMP_LEN 20
+#define GAMECLOCK_TIMESTAMP_SLOTS 4
+// a sample older than this (ms) means the world thread stalls, timestamps are formatted from the live clock then
+#define GAMECLOCK_STALE_TIME 1000
+
+/// Clocks sampled once per world tick, so hot paths do not call time() and localtime() per object or per log line.
+/// Values are as of the last sample; until the first sample every getter falls back to the libc clock.
+class GameClock
+{
+public:
+	/// Sample all clocks, only the world thread calls it (World::_UpdateGameTime)
+	static void Update();
+
+	/// Wall clock, in seconds
+	static time_t GetGameTime()
+	{
+		time_t gameTime = m_gameTime.load(std::memory_order_relaxed);
+		return gameTime ? gameTime : time(nullptr);
+	}
+
+	/// Monotonic server time in ms, same base as WorldTimer::getMSTime()
+	static uint32 GetMSTime();
+
+	/// Local time of GetGameTime() formatted as "YYYY-MM-DD HH:MM:SS", copied into buf.
+	/// The live time while the world thread did not sample for GAMECLOCK_STALE_TIME, so stall logs stay accurate.
+	static void GetTimestamp(char (&buf)[GAMECLOCK_TIMESTAMP_LEN]);
+
+private:
+	static void FormatTimestamp(time_t t, char (&buf)[GAMECLOCK_TIMESTAMP_LEN]);
+
+	static std::atomic<time_t> m_gameTime;
+	static std::atomic<uint32> m_msTime;
+
+	// the world thread formats into the next slot and publishes it, readers copy the current one
+	static char m_timestamps[GAMECLOCK_TIMESTAMP_SLOTS][GAMECLOCK_TIMESTAMP_LEN];
+	static std::atomic<uint32> m_timestampSlot;
+	static time_t m_timestampTime;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "Watchdog.h"
+#include "Timer.h"
+#include "../Log/Log.h"
+
+using namespace Origin;
+
+WatchdogBreadcrumb Watchdog::m_slots[WATCHDOG_MAX_THREADS];
+uint32 Watchdog::m_nearStallTime = 50;
+WatchdogPhaseStats Watchdog::m_phaseStats[WATCHDOG_MAX_PHASES];
+
+static uint32 const s_phaseBucketLimits[WATCHDOG_PHASE_BUCKETS - 1] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000 };
+
+static thread_local WatchdogBreadcrumb* t_breadcrumb = nullptr;
+
+static char const* ThreadTypeName(uint32 type)
+{
+	switch (type)
+	{
+		case WATCHDOG_THREAD_WORLD:   return "world";
+		case WATCHDOG_THREAD_MAP:     return "map";
+		case WATCHDOG_THREAD_NETWORK: return "network";
+		default:                      return "other";
+	}
+}
+
+static char const* PhaseName(char const* phase)
+{
+	return phase ? phase : "<none>";
+}
+
+void Watchdog::RegisterThread(char const* name, WatchdogThreadType type)
+{
+	if (t_breadcrumb)
+		return;
+
+	for (int i = 0; i < WATCHDOG_MAX_THREADS; ++i)
+	{
+		bool expected = false;
+		if (!m_slots[i].used.compare_exchange_strong(expected, true))
+			continue;
+
+		WatchdogBreadcrumb& slot = m_slots[i];
+		slot.name = name;
+		slot.type = type;
+		slot.depth = 0;
+		slot.busySince = 0;
+		slot.phase = nullptr;
+		slot.phaseStart = 0;
+		slot.mapId = WATCHDOG_NO_VALUE;
+		slot.opcode = WATCHDOG_NO_VALUE;
+		for (int b = 0; b < WATCHDOG_HISTOGRAM_BUCKETS; ++b)
+			slot.histogram[b] = 0;
+		for (int h = 0; h < WATCHDOG_NEAR_STALL_HISTORY; ++h)
+			slot.history[h].phase = nullptr;
+		slot.historyPos = 0;
+
+		t_breadcrumb = &slot;
+		return;
+	}
+
+	sLog.outError("Watchdog: no free breadcrumb slot for thread '%s', it will not be watched", name);
+}
+
+void Watchdog::UnregisterThread()
+{
+	if (!t_breadcrumb)
+		return;
+
+	t_breadcrumb->depth = 0;
+	t_breadcrumb->used = false;
+	t_breadcrumb = nullptr;
+}
+
+void Watchdog::BeginPhase(char const* phase, uint32 mapId, uint32 opcode)
+{
+	WatchdogBreadcrumb* slot = t_breadcrumb;
+	uint32 now = WorldTimer::getMSTime();
+
+	if (mapId != WATCHDOG_NO_VALUE)
+		slot->mapId.store(mapId, std::memory_order_relaxed);
+	if (opcode != WATCHDOG_NO_VALUE)
+		slot->opcode.store(opcode, std::memory_order_relaxed);
+	slot->phase.store(phase, std::memory_order_relaxed);
+	slot->phaseStart.store(now, std::memory_order_relaxed);
+
+	if (slot->depth.load(std::memory_order_relaxed) == 0)
+		slot->busySince.store(now, std::memory_order_relaxed);
+	// release so the watchdog never sees the new depth with stale timestamps
+	slot->depth.fetch_add(1, std::memory_order_release);
+}
+
+void Watchdog::EndPhase(char const* prevPhase, uint32 prevMapId, uint32 prevOpcode, uint32 prevStart, uint32 stallsBefore)
+{
+	WatchdogBreadcrumb* slot = t_breadcrumb;
+	uint32 duration = WorldTimer::getMSTimeDiff(slot->phaseStart.load(std::memory_order_relaxed), WorldTimer::getMSTime());
+
+	// a nested phase recorded this slow tick already, counting it again here would inflate the histogram
+	bool nestedStall = slot->historyPos.load(std::memory_order_relaxed) != stallsBefore;
+	if (duration >= m_nearStallTime && !nestedStall)
+	{
+		uint32 bucket = 0;
+		for (uint32 limit = m_nearStallTime * 2; duration >= limit && bucket < WATCHDOG_HISTOGRAM_BUCKETS - 1; limit *= 2)
+			++bucket;
+		slot->histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+		WatchdogNearStall& entry = slot->history[slot->historyPos.load(std::memory_order_relaxed) % WATCHDOG_NEAR_STALL_HISTORY];
+		entry.mapId.store(slot->mapId.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		entry.opcode.store(slot->opcode.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		entry.duration.store(duration, std::memory_order_relaxed);
+		entry.phase.store(slot->phase.load(std::memory_order_relaxed), std::memory_order_release);
+		slot->historyPos.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	slot->depth.fetch_sub(1, std::memory_order_release);
+	slot->phase.store(prevPhase, std::memory_order_relaxed);
+	slot->phaseStart.store(prevStart, std::memory_order_relaxed);
+	slot->mapId.store(prevMapId, std::memory_order_relaxed);
+	slot->opcode.store(prevOpcode, std::memory_order_relaxed);
+}
+
+int Watchdog::FindStalledThread(uint32 maxStuckTime)
+{
+	uint32 now = WorldTimer::getMSTime();
+
+	for (int i = 0; i < WATCHDOG_MAX_THREADS; ++i)
+	{
+		WatchdogBreadcrumb const& slot = m_slots[i];
+		if (!slot.used || !slot.depth.load(std::memory_order_acquire))
+			continue;
+
+		if (WorldTimer::getMSTimeDiff(slot.busySince.load(std::memory_order_relaxed), now) > maxStuckTime)
+			return i;
+	}
+
+	return -1;
+}
+
+uint32 Watchdog::GetNearStallCount()
+{
+	uint32 count = 0;
+	for (int i = 0; i < WATCHDOG_MAX_THREADS; ++i)
+		for (int b = 0; b < WATCHDOG_HISTOGRAM_BUCKETS; ++b)
+			count += m_slots[i].histogram[b].load(std::memory_order_relaxed);
+	return count;
+}
+
+void Watchdog::DumpBreadcrumbs()
+{
+	uint32 now = WorldTimer::getMSTime();
+
+	sLog.outError("Watchdog breadcrumbs (near-stall threshold %u ms):", m_nearStallTime);
+	for (int i = 0; i < WATCHDOG_MAX_THREADS; ++i)
+	{
+		WatchdogBreadcrumb const& slot = m_slots[i];
+		if (!slot.used)
+			continue;
+
+		if (slot.depth.load(std::memory_order_acquire))
+			sLog.outError("  [%d] %s thread '%s': phase '%s' map %d opcode %d since %u ms, busy for %u ms", i,
+				ThreadTypeName(slot.type), PhaseName(slot.name), PhaseName(slot.phase),
+				int32(slot.mapId.load()), int32(slot.opcode.load()),
+				WorldTimer::getMSTimeDiff(slot.phaseStart, now), WorldTimer::getMSTimeDiff(slot.busySince, now));
+		else
+			sLog.outError("  [%d] %s thread '%s': idle", i, ThreadTypeName(slot.type), PhaseName(slot.name));
+
+		std::ostringstream histogram;
+		uint32 total = 0;
+		for (int b = 0; b < WATCHDOG_HISTOGRAM_BUCKETS; ++b)
+		{
+			uint32 count = slot.histogram[b].load(std::memory_order_relaxed);
+			total += count;
+			histogram << " >=" << (m_nearStallTime << b) << "ms:" << count;
+		}
+		if (!total)
+			continue;
+
+		sLog.outError("      near-stalls:%s", histogram.str().c_str());
+
+		uint32 pos = slot.historyPos.load(std::memory_order_relaxed);
+		uint32 first = pos > WATCHDOG_NEAR_STALL_HISTORY ? pos - WATCHDOG_NEAR_STALL_HISTORY : 0;
+		for (uint32 h = first; h < pos; ++h)
+		{
+			WatchdogNearStall const& entry = slot.history[h % WATCHDOG_NEAR_STALL_HISTORY];
+			sLog.outError("      %u ms in '%s' map %d opcode %d", entry.duration.load(),
+				PhaseName(entry.phase.load(std::memory_order_acquire)), int32(entry.mapId.load()), int32(entry.opcode.load()));
+		}
+	}
+}
+
+uint32 Watchdog::GetPhaseBucketLimit(uint32 bucket)
+{
+	return bucket < WATCHDOG_PHASE_BUCKETS - 1 ? s_phaseBucketLimits[bucket] : 0;
+}
+
+/// Phase names are string literals, so the pointer is the key. Slots are claimed lock free and never given back.
+void Watchdog::AddPhaseTime(char const* phase, uint32 usTime)
+{
+	uint32 index = uint32((reinterpret_cast<uintptr_t>(phase) >> 3) % WATCHDOG_MAX_PHASES);
+	for (uint32 probe = 0; probe < WATCHDOG_MAX_PHASES; ++probe, index = (index + 1) % WATCHDOG_MAX_PHASES)
+	{
+		WatchdogPhaseStats& stats = m_phaseStats[index];
+		char const* current = stats.phase.load(std::memory_order_acquire);
+		if (!current && stats.phase.compare_exchange_strong(current, phase, std::memory_order_acq_rel))
+			current = phase;
+		if (current != phase)
+			continue;
+
+		uint32 bucket = 0;
+		while (bucket < WATCHDOG_PHASE_BUCKETS - 1 && usTime >= s_phaseBucketLimits[bucket])
+			++bucket;
+
+		stats.count.fetch_add(1, std::memory_order_relaxed);
+		stats.totalTime.fetch_add(usTime, std::memory_order_relaxed);
+		stats.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+		uint32 maxTime = stats.maxTime.load(std::memory_order_relaxed);
+		while (usTime > maxTime && !stats.maxTime.compare_exchange_weak(maxTime, usTime, std::memory_order_relaxed)) {}
+		return;
+	}
+	// table full, the phase is not counted
+}
+
+void Watchdog::ResetPhaseStats()
+{
+	for (int i = 0; i < WATCHDOG_MAX_PHASES; ++i)
+	{
+		WatchdogPhaseStats& stats = m_phaseStats[i];
+		stats.count = 0;
+		stats.totalTime = 0;
+		stats.maxTime = 0;
+		for (int b = 0; b < WATCHDOG_PHASE_BUCKETS; ++b)
+			stats.histogram[b] = 0;
+	}
+}
+
+WatchdogPhase::WatchdogPhase(char const* phase, uint32 mapId, uint32 opcode) : m_active(false)
+{
+	WatchdogBreadcrumb* slot = t_breadcrumb;
+	if (!slot)
+		return;
+
+	m_active = true;
+	m_phase = phase;
+	m_start = std::chrono::steady_clock::now();
+	m_prevPhase = slot->phase.load(std::memory_order_relaxed);
+	m_prevMapId = slot->mapId.load(std::memory_order_relaxed);
+	m_prevOpcode = slot->opcode.load(std::memory_order_relaxed);
+	m_prevStart = slot->phaseStart.load(std::memory_order_relaxed);
+	m_stallsBefore = slot->historyPos.load(std::memory_order_relaxed);
+
+	Watchdog::BeginPhase(phase, mapId, opcode);
+}
+
+WatchdogPhase::~WatchdogPhase()
+{
+	if (!m_active || !t_breadcrumb)
+		return;
+
+	Watchdog::EndPhase(m_prevPhase, m_prevMapId, m_prevOpcode, m_prevStart, m_stallsBefore);
+	Watchdog::AddPhaseTime(m_phase, uint32(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count()));
+}
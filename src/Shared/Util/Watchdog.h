@@ -0,0 +1,128 @@
+#ifndef ORIGIN_WATCHDOG_H
+#define ORIGIN_WATCHDOG_H
+
+#include "../Common.h"
+
+#include <atomic>
+#include <chrono>
+
+#define WATCHDOG_MAX_THREADS            64
+#define WATCHDOG_HISTOGRAM_BUCKETS      8
+#define WATCHDOG_NEAR_STALL_HISTORY     16
+#define WATCHDOG_NO_VALUE               0xFFFFFFFF
+#define WATCHDOG_MAX_PHASES             128
+#define WATCHDOG_PHASE_BUCKETS          10
+
+namespace Origin
+{
+	enum WatchdogThreadType
+	{
+		WATCHDOG_THREAD_WORLD   = 0,
+		WATCHDOG_THREAD_MAP     = 1,
+		WATCHDOG_THREAD_NETWORK = 2,
+		WATCHDOG_THREAD_OTHER   = 3
+	};
+
+	/// One slow phase, kept so the dump can point at the handler which caused it
+	struct WatchdogNearStall
+	{
+		std::atomic<char const*> phase;
+		std::atomic<uint32> mapId;
+		std::atomic<uint32> opcode;
+		std::atomic<uint32> duration;
+	};
+
+	/// Last known position of a watched thread.
+	/// Only the owner thread writes it, the watchdog thread reads it without locking.
+	struct WatchdogBreadcrumb
+	{
+		std::atomic<bool> used;
+		std::atomic<char const*> name;
+		std::atomic<uint32> type;
+
+		std::atomic<uint32> depth;                          // nested phases currently open, 0 when idle
+		std::atomic<uint32> busySince;                      // start of the outermost open phase
+		std::atomic<char const*> phase;                     // innermost open phase
+		std::atomic<uint32> phaseStart;
+		std::atomic<uint32> mapId;
+		std::atomic<uint32> opcode;
+
+		std::atomic<uint32> histogram[WATCHDOG_HISTOGRAM_BUCKETS];
+		WatchdogNearStall history[WATCHDOG_NEAR_STALL_HISTORY];
+		std::atomic<uint32> historyPos;
+	};
+
+	/// Duration statistics of one phase name over all threads, times in microseconds
+	struct WatchdogPhaseStats
+	{
+		std::atomic<char const*> phase;
+		std::atomic<uint64> count;
+		std::atomic<uint64> totalTime;
+		std::atomic<uint32> maxTime;
+		std::atomic<uint64> histogram[WATCHDOG_PHASE_BUCKETS];
+	};
+
+	/// Tracks what every world, map and network thread is doing, so that a hang
+	/// or a lag spike can be tied to a tick phase, a map and an opcode.
+	class Watchdog
+	{
+	public:
+		/// Give the calling thread a breadcrumb slot, must be called once from the thread itself
+		static void RegisterThread(char const* name, WatchdogThreadType type);
+		static void UnregisterThread();
+
+		/// Phases longer than this (in ms) are counted in the near-stall histogram, a slow tick only once
+		/// by the innermost phase which was slow
+		static void SetNearStallTime(uint32 msTime) { m_nearStallTime = msTime ? msTime : 1; }
+		static uint32 GetNearStallTime() { return m_nearStallTime; }
+
+		static void BeginPhase(char const* phase, uint32 mapId, uint32 opcode);
+		/// stallsBefore is historyPos of the thread when the phase began
+		static void EndPhase(char const* prevPhase, uint32 prevMapId, uint32 prevOpcode, uint32 prevStart, uint32 stallsBefore);
+
+		/// Return the slot index of the first thread busy for more than maxStuckTime ms, -1 if none
+		static int FindStalledThread(uint32 maxStuckTime);
+
+		/// Write breadcrumbs, histograms and recent near-stalls of all threads to the error log
+		static void DumpBreadcrumbs();
+		static uint32 GetNearStallCount();
+
+		/// Per phase statistics, slots with a null phase are unused
+		static WatchdogPhaseStats const& GetPhaseStats(uint32 index) { return m_phaseStats[index]; }
+		/// Upper limit (exclusive, in microseconds) of a histogram bucket, the last bucket has none
+		static uint32 GetPhaseBucketLimit(uint32 bucket);
+		static void ResetPhaseStats();
+
+	private:
+		friend class WatchdogPhase;
+		static void AddPhaseTime(char const* phase, uint32 usTime);
+
+		static WatchdogBreadcrumb m_slots[WATCHDOG_MAX_THREADS];
+		static uint32 m_nearStallTime;
+		static WatchdogPhaseStats m_phaseStats[WATCHDOG_MAX_PHASES];
+	};
+
+	/// Scoped phase marker, restores the enclosing phase of the thread when it goes out of scope.
+	/// Does nothing on threads which did not call Watchdog::RegisterThread.
+	class WatchdogPhase
+	{
+	public:
+		explicit WatchdogPhase(char const* phase, uint32 mapId = WATCHDOG_NO_VALUE, uint32 opcode = WATCHDOG_NO_VALUE);
+		~WatchdogPhase();
+
+	private:
+		WatchdogPhase(WatchdogPhase const&);
+		WatchdogPhase& operator=(WatchdogPhase const&);
+
+		bool m_active;
+		char const* m_phase;
+		std::chrono::steady_clock::time_point m_start;
+		char const* m_prevPhase;
+		uint32 m_prevMapId;
+		uint32 m_prevOpcode;
+		uint32 m_prevStart;
+		uint32 m_stallsBefore;
+	};
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Origin;
+
+namespace
+{
+	struct BenchmarkEntry
+	{
+		char const* name;
+		BenchmarkFunc func;
+	};
+
+	// function local, registration runs during static initialization of the other translation units
+	std::vector<BenchmarkEntry>& GetRegistry()
+	{
+		static std::vector<BenchmarkEntry> registry;
+		return registry;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	double TimeRun(BenchmarkFunc func, uint64 iterations)
+	{
+		Clock::time_point start = Clock::now();
+		func(iterations);
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+	void Usage(char const* program)
+	{
+		printf("Usage: %s [--filter <substring>] [--samples <n>] [--min-time <ms>] [--csv] [--list]\n"
+			"  --filter    only run benchmarks whose name contains the substring\n"
+			"  --samples   timed samples per benchmark, the median is reported (15)\n"
+			"  --min-time  minimum duration of one sample, iterations are scaled to reach it (50)\n"
+			"  --csv       print name,iterations,median_ns,min_ns,spread_pct instead of the table\n"
+			"  --list      only print the benchmark names\n", program);
+	}
+}
+
+void Benchmarks::Register(char const* name, BenchmarkFunc func)
+{
+	BenchmarkEntry entry = { name, func };
+	GetRegistry().push_back(entry);
+}
+
+/// Each benchmark is calibrated (doubling the iterations until one run takes --min-time), warmed up once
+/// and then timed --samples times. Median and minimum per operation are reported together with the
+/// spread between the median and the slowest quartile, results with a large spread are not trustworthy.
+int Benchmarks::Run(int argc, char** argv)
+{
+	char const* filter = nullptr;
+	uint32 samples = 15;
+	double minTime = 50.0 * 1000 * 1000;
+	bool csv = false;
+	bool list = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--csv"))
+			csv = true;
+		else if (!strcmp(argv[i], "--list"))
+			list = true;
+		else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+			filter = argv[++i];
+		else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+			samples = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+			minTime = std::max(1, atoi(argv[++i])) * 1000.0 * 1000.0;
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<BenchmarkEntry> benchmarks = GetRegistry();
+	std::sort(benchmarks.begin(), benchmarks.end(), [](BenchmarkEntry const& a, BenchmarkEntry const& b) { return strcmp(a.name, b.name) < 0; });
+
+	if (csv)
+		printf("name,iterations,median_ns,min_ns,spread_pct\n");
+	else if (!list)
+		printf("%-36s %12s %12s %12s %8s\n", "benchmark", "iterations", "median ns", "min ns", "spread");
+
+	for (size_t b = 0; b < benchmarks.size(); ++b)
+	{
+		BenchmarkEntry const& entry = benchmarks[b];
+		if (filter && !strstr(entry.name, filter))
+			continue;
+
+		if (list)
+		{
+			printf("%s\n", entry.name);
+			continue;
+		}
+
+		uint64 iterations = 1;
+		while (TimeRun(entry.func, iterations) < minTime && iterations < (uint64(1) << 40))
+			iterations *= 2;
+
+		// warm up caches and branch predictors at the final size
+		TimeRun(entry.func, iterations);
+
+		std::vector<double> perOp(samples);
+		for (uint32 s = 0; s < samples; ++s)
+			perOp[s] = TimeRun(entry.func, iterations) / iterations;
+		std::sort(perOp.begin(), perOp.end());
+
+		double median = perOp[samples / 2];
+		double upperQuartile = perOp[(samples * 3) / 4];
+		double spread = median > 0.0 ? (upperQuartile - median) * 100.0 / median : 0.0;
+
+		if (csv)
+			printf("%s,%llu,%.3f,%.3f,%.2f\n", entry.name, (unsigned long long)iterations, median, perOp[0], spread);
+		else
+			printf("%-36s %12llu %12.2f %12.2f %7.2f%%\n", entry.name, (unsigned long long)iterations, median, perOp[0], spread);
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	return Benchmarks::Run(argc, argv);
+}
@@ -0,0 +1,49 @@
+#ifndef ORIGIN_BENCHMARK_H
+#define ORIGIN_BENCHMARK_H
+
+#include "../Shared/Define.h"
+
+#if COMPILER == COMPILER_MICROSOFT
+#  include <intrin.h>
+#endif
+
+namespace Origin
+{
+	/// Runs `iterations` operations of one benchmark, the harness divides the elapsed time by it
+	typedef void (*BenchmarkFunc)(uint64 iterations);
+
+	class Benchmarks
+	{
+	public:
+		static void Register(char const* name, BenchmarkFunc func);
+
+		/// Runs every registered benchmark matching the filter and prints the results, see Usage() for the options
+		static int Run(int argc, char** argv);
+	};
+
+	struct BenchmarkRegistrar
+	{
+		BenchmarkRegistrar(char const* name, BenchmarkFunc func) { Benchmarks::Register(name, func); }
+	};
+
+	/// Keep the compiler from optimizing away a value the benchmark computes
+	template<typename T>
+	inline void DoNotOptimize(T const& value)
+	{
+#if COMPILER == COMPILER_MICROSOFT
+		static void const* volatile sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+}
+
+/// BENCHMARK(Name) { for (uint64 i = 0; i < iterations; ++i) ... }
+#define BENCHMARK(name) \
+	static void Benchmark_##name(uint64 iterations); \
+	static Origin::BenchmarkRegistrar s_benchmark_##name(#name, &Benchmark_##name); \
+	static void Benchmark_##name(uint64 iterations)
+
+#endif
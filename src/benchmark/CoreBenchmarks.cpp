@@ -0,0 +1,315 @@
+#include "Benchmark.h"
+
+#include "../Shared/Common.h"
+#include "../Shared/Util/ByteBuffer.h"
+#include "../Shared/Util/WorldPacket.h"
+#include "../Shared/Util/Util.h"
+#include "../Shared/Network/PacketBuffer.h"
+#include "../Shared/Database/Field.h"
+#include "../game/Object/UpdateMask.h"
+#include "../game/Object/ObjectGuid.h"
+#include "../game/Object/ObjectAccessor.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using Origin::DoNotOptimize;
+
+// every benchmark draws from its own fixed seed, so runs are comparable
+#define BENCHMARK_SEED 0x0A161
+
+// ---- ByteBuffer / WorldPacket ----
+
+/// guid + position, the layout of the relayed MSG_MOVEMENT
+BENCHMARK(ByteBuffer_AppendMovement)
+{
+	ByteBuffer buf(64);
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		buf.clear();
+		buf << uint32(i) << float(1.0f) << float(2.0f) << float(3.0f) << float(0.5f);
+		DoNotOptimize(buf.contents());
+	}
+}
+
+BENCHMARK(ByteBuffer_AppendString)
+{
+	std::string const name = "Someplayername";
+	ByteBuffer buf(64);
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		buf.clear();
+		buf << name << uint8(1) << uint8(2);
+		DoNotOptimize(buf.contents());
+	}
+}
+
+BENCHMARK(ByteBuffer_ReadMovement)
+{
+	ByteBuffer buf(64);
+	buf << uint32(42) << float(1.0f) << float(2.0f) << float(3.0f) << float(0.5f);
+
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		buf.rpos(0);
+		uint32 guid;
+		float x, y, z, o;
+		buf >> guid >> x >> y >> z >> o;
+		DoNotOptimize(guid);
+		DoNotOptimize(x + y + z + o);
+	}
+}
+
+/// the same movement read through the non-throwing reader the handlers use
+BENCHMARK(PacketReader_ReadMovement)
+{
+	ByteBuffer buf(64);
+	buf << uint32(42) << float(1.0f) << float(2.0f) << float(3.0f) << float(0.5f);
+
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		buf.rpos(0);
+		uint32 guid;
+		float x, y, z, o;
+		PacketReader reader(buf);
+		reader >> guid >> x >> y >> z >> o;
+		DoNotOptimize(bool(reader));
+		DoNotOptimize(x + y + z + o);
+	}
+}
+
+/// a truncated packet, failing costs no more than succeeding
+BENCHMARK(PacketReader_Truncated)
+{
+	ByteBuffer buf(64);
+	buf << uint32(42) << float(1.0f);
+
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		buf.rpos(0);
+		uint32 guid;
+		float x, y, z, o;
+		PacketReader reader(buf);
+		reader >> guid >> x >> y >> z >> o;
+		DoNotOptimize(bool(reader));
+	}
+}
+
+BENCHMARK(ByteBuffer_ReadString)
+{
+	ByteBuffer buf(64);
+	buf << std::string("Someplayername") << std::string("0123456789abcdef0123456789abcdef") << uint32(1499);
+
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		buf.rpos(0);
+		std::string account, password;
+		uint32 build;
+		buf >> account >> password >> build;
+		DoNotOptimize(account);
+		DoNotOptimize(build);
+	}
+}
+
+/// build a movement relay packet and copy it, as broadcasting to another player does
+BENCHMARK(WorldPacket_BuildAndCopy)
+{
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		WorldPacket data(MSG_MOVEMENT, 4 + 4 + 4 + 4 + 4);
+		data << uint32(i) << float(1.0f) << float(2.0f) << float(3.0f) << float(0.5f);
+		WorldPacket copy(data);
+		DoNotOptimize(copy.contents());
+	}
+}
+
+// ---- UpdateMask ----
+
+#define BENCHMARK_UPDATE_FIELDS 1200
+
+BENCHMARK(UpdateMask_SetGetBits)
+{
+	std::mt19937 rng(BENCHMARK_SEED);
+	std::vector<uint32> indexes(256);
+	for (size_t i = 0; i < indexes.size(); ++i)
+		indexes[i] = rng() % BENCHMARK_UPDATE_FIELDS;
+
+	UpdateMask mask;
+	mask.SetCount(BENCHMARK_UPDATE_FIELDS);
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		uint32 index = indexes[i & 255];
+		mask.SetBit(index);
+		DoNotOptimize(mask.GetBit(indexes[(i + 1) & 255]));
+		mask.UnsetBit(indexes[(i + 2) & 255]);
+	}
+}
+
+BENCHMARK(UpdateMask_OrAnd)
+{
+	UpdateMask a, b;
+	a.SetCount(BENCHMARK_UPDATE_FIELDS);
+	b.SetCount(BENCHMARK_UPDATE_FIELDS);
+	for (uint32 i = 0; i < BENCHMARK_UPDATE_FIELDS; i += 3)
+		b.SetBit(i);
+
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		a |= b;
+		a &= b;
+		DoNotOptimize(a.GetMask());
+	}
+}
+
+BENCHMARK(UpdateMask_Copy)
+{
+	UpdateMask source;
+	source.SetCount(BENCHMARK_UPDATE_FIELDS);
+	source.SetBit(7);
+
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		UpdateMask copy(source);
+		DoNotOptimize(copy.GetMask());
+	}
+}
+
+// ---- ObjectGuid in HashMapHolder ----
+
+namespace
+{
+	struct BenchmarkObject
+	{
+		ObjectGuid guid;
+		ObjectGuid GetObjectGuid() const { return guid; }
+	};
+}
+
+template<> HashMapHolder<BenchmarkObject>::MapType HashMapHolder<BenchmarkObject>::m_objectMap{};
+template<> std::mutex HashMapHolder<BenchmarkObject>::i_lock{};
+
+#define BENCHMARK_OBJECTS 10000
+
+namespace
+{
+	/// players as HashMapHolder sees them, filled once
+	std::vector<BenchmarkObject>& GetBenchmarkObjects()
+	{
+		static std::vector<BenchmarkObject> objects;
+		if (objects.empty())
+		{
+			objects.resize(BENCHMARK_OBJECTS);
+			for (uint32 i = 0; i < BENCHMARK_OBJECTS; ++i)
+			{
+				objects[i].guid = ObjectGuid(HIGHGUID_PLAYER, i + 1);
+				HashMapHolder<BenchmarkObject>::Insert(&objects[i]);
+			}
+		}
+		return objects;
+	}
+}
+
+BENCHMARK(HashMapHolder_Find)
+{
+	GetBenchmarkObjects();
+
+	std::mt19937 rng(BENCHMARK_SEED);
+	std::vector<ObjectGuid> lookups(1024);
+	for (size_t i = 0; i < lookups.size(); ++i)
+		lookups[i] = ObjectGuid(HIGHGUID_PLAYER, uint32(rng() % (BENCHMARK_OBJECTS * 2) + 1));   // half of them miss
+
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(HashMapHolder<BenchmarkObject>::Find(lookups[i & 1023]));
+}
+
+BENCHMARK(HashMapHolder_InsertRemove)
+{
+	std::vector<BenchmarkObject>& objects = GetBenchmarkObjects();
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		BenchmarkObject* object = &objects[i % BENCHMARK_OBJECTS];
+		HashMapHolder<BenchmarkObject>::Remove(object);
+		HashMapHolder<BenchmarkObject>::Insert(object);
+	}
+}
+
+BENCHMARK(ObjectGuid_Hash)
+{
+	std::hash<ObjectGuid> hasher;
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(hasher(ObjectGuid(HIGHGUID_PLAYER, uint32(i) + 1)));
+}
+
+// ---- PacketBuffer ----
+
+/// header plus movement body, written and read back the way Socket frames traffic.
+/// A fresh buffer every 200 packets, PacketBuffer has no public reset, so its construction is part of the cost.
+BENCHMARK(PacketBuffer_WriteRead)
+{
+	char const packet[6 + 16] = { 0 };
+	char out[sizeof(packet)];
+
+	std::unique_ptr<Origin::PacketBuffer> buffer;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		if (i % 200 == 0)
+			buffer.reset(new Origin::PacketBuffer());
+
+		buffer->Write(packet, sizeof(packet));
+		buffer->Read(out, sizeof(out));
+		DoNotOptimize(out[0]);
+	}
+}
+
+// ---- Field ----
+
+BENCHMARK(Field_GetUInt32)
+{
+	Field field;
+	field.SetValue("123456789");
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(field.GetUInt32());
+}
+
+BENCHMARK(Field_GetUInt64)
+{
+	Field field;
+	field.SetValue("12345678901234");
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(field.GetUInt64());
+}
+
+BENCHMARK(Field_GetFloat)
+{
+	Field field;
+	field.SetValue("-8913.2333984375");
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(field.GetFloat());
+}
+
+BENCHMARK(Field_GetCppString)
+{
+	Field field;
+	field.SetValue("Someplayername");
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(field.GetCppString());
+}
+
+// ---- StrSplit ----
+
+/// a saved field array, 200 numbers separated by spaces
+BENCHMARK(StrSplit_Fields)
+{
+	std::mt19937 rng(BENCHMARK_SEED);
+	std::string data;
+	for (int i = 0; i < 200; ++i)
+	{
+		data += std::to_string(rng() % 100000);
+		data += ' ';
+	}
+
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(StrSplit(data, " "));
+}
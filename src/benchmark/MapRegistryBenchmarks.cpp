@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+
+#include "../Shared/Common.h"
+#include "../game/Map/MapRegistry.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Origin::DoNotOptimize;
+
+// one operation is one map lookup on the measured thread, while the other threads look up maps as fast as they can
+#define REGISTRY_SEED           0x0A161
+#define REGISTRY_CONTINENTS     4
+#define REGISTRY_INSTANCES      200         // dungeon instances, spread over a few map ids
+#define REGISTRY_LOOKUPS        1024        // drawn once, looked up in turn
+
+namespace
+{
+	/// what MapManager did before MapRegistry, every lookup under the class lock
+	class LockedRegistry
+	{
+	public:
+		Map* Find(MapID const& id) const
+		{
+			std::lock_guard<std::recursive_mutex> guard(m_mutex);
+			std::map<MapID, Map*>::const_iterator itr = m_maps.find(id);
+			return itr != m_maps.end() ? itr->second : nullptr;
+		}
+
+		void Insert(MapID const& id, Map* map)
+		{
+			std::lock_guard<std::recursive_mutex> guard(m_mutex);
+			m_maps[id] = map;
+		}
+
+	private:
+		mutable std::recursive_mutex m_mutex;
+		std::map<MapID, Map*> m_maps;
+	};
+
+	/// the maps are never dereferenced, any distinct address will do
+	Map* FakeMap(uint32 index) { return reinterpret_cast<Map*>(uintptr_t(index + 1) * 64); }
+
+	template<class Registry>
+	void Fill(Registry& registry)
+	{
+		for (uint32 i = 0; i < REGISTRY_CONTINENTS; ++i)
+			registry.Insert(MapID(i), FakeMap(i));
+		for (uint32 i = 0; i < REGISTRY_INSTANCES; ++i)
+			registry.Insert(MapID(30 + i % 20, i + 1), FakeMap(REGISTRY_CONTINENTS + i));
+	}
+
+	/// mostly continents, the way sessions look up the map of their player
+	std::vector<MapID> const& GetLookups()
+	{
+		static std::vector<MapID> lookups;
+		if (lookups.empty())
+		{
+			std::mt19937 rng(REGISTRY_SEED);
+			for (uint32 i = 0; i < REGISTRY_LOOKUPS; ++i)
+			{
+				if (rng() % 4)
+					lookups.push_back(MapID(rng() % REGISTRY_CONTINENTS));
+				else
+				{
+					uint32 instance = rng() % REGISTRY_INSTANCES;
+					lookups.push_back(MapID(30 + instance % 20, instance + 1));
+				}
+			}
+		}
+		return lookups;
+	}
+
+	template<class Registry>
+	void RunLookups(Registry const& registry, uint32 threads, uint64 iterations)
+	{
+		std::vector<MapID> const& lookups = GetLookups();
+
+		std::atomic<bool> stop(false);
+		std::vector<std::thread> readers;
+		for (uint32 t = 1; t < threads; ++t)
+		{
+			readers.push_back(std::thread([&registry, &lookups, &stop, t]()
+			{
+				for (size_t i = t; !stop.load(std::memory_order_relaxed); ++i)
+					DoNotOptimize(registry.Find(lookups[i % REGISTRY_LOOKUPS]));
+			}));
+		}
+
+		for (uint64 i = 0; i < iterations; ++i)
+			DoNotOptimize(registry.Find(lookups[i % REGISTRY_LOOKUPS]));
+
+		stop = true;
+		for (size_t t = 0; t < readers.size(); ++t)
+			readers[t].join();
+	}
+
+	template<class Registry>
+	Registry const& GetRegistry()
+	{
+		static Registry registry;
+		static bool filled = false;
+		if (!filled)
+		{
+			Fill(registry);
+			filled = true;
+		}
+		return registry;
+	}
+}
+
+#define MAP_REGISTRY_BENCHMARKS(threads) \
+	BENCHMARK(MapRegistry_Locked_Find_T##threads) { RunLookups(GetRegistry<LockedRegistry>(), threads, iterations); } \
+	BENCHMARK(MapRegistry_Snapshot_Find_T##threads) { RunLookups(GetRegistry<MapRegistry>(), threads, iterations); }
+
+MAP_REGISTRY_BENCHMARKS(1)
+MAP_REGISTRY_BENCHMARKS(2)
+MAP_REGISTRY_BENCHMARKS(4)
+MAP_REGISTRY_BENCHMARKS(8)
+
+/// a new instance every call, the copy of the snapshot is what a change costs now. MapManager reclaims once per
+/// update, a few instances are created in between at most.
+BENCHMARK(MapRegistry_Snapshot_Insert)
+{
+	MapRegistry registry;
+	Fill(registry);
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		registry.Insert(MapID(60, uint32(i)), FakeMap(uint32(i)));
+		if (i % 4 == 3)
+			registry.Reclaim();
+	}
+	DoNotOptimize(registry.GetMaps().size());
+}
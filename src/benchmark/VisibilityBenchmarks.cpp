@@ -0,0 +1,494 @@
+#include "Benchmark.h"
+
+#include "../Shared/Common.h"
+#include "../game/Map/MapGrid.h"
+#include "../game/Map/MapRegion.h"
+#include "../game/Map/MapVisibility.h"
+#include "../game/Map/MapWorkerPool.h"
+#include "../game/Map/PositionFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+using Origin::DoNotOptimize;
+
+// one operation is one visibility tick of a whole map: a tenth of the players moved, then
+// every player gains the ones which came into range and loses the ones which left it
+#define VISIBILITY_SEED         0x0A161
+#define VISIBILITY_DISTANCE     90.0f
+#define VISIBILITY_AREA         3000.0f     // players are spread over a square of this side, about one zone
+#define VISIBILITY_CITY_AREA    300.0f      // a crowded city, where nobody moves
+#define VISIBILITY_STEP         7.0f        // farthest a moving player gets in one tick
+#define VISIBILITY_TICK         100         // ms, the map update interval
+// the World defaults of Visibility.RelocationLowerLimit and Visibility.PlayerRelocationNotifyDelay
+#define VISIBILITY_RELOCATION_LIMIT_SQ  (10.0f * 10.0f)
+#define VISIBILITY_NOTIFY_DELAY 250
+#define POSITION_FILTER_COUNT   4096        // positions per filter run, a crowded cell is far less
+#define VISIBILITY_CHECK_TICKS  50          // ticks a new flat or sharded scene is checked against the one before it
+
+namespace
+{
+	/// what the visibility pass needs of a Player, see MapVisibility
+	struct VisibilityObject : public VisibilityTracker<VisibilityObject>
+	{
+		uint32 id;
+		float x, y, z;
+		std::set<uint32> visible;                       // of the passes from before the flat lists
+		MapGridRef gridRef;
+		MapRegionRef regionRef;
+
+		uint64 GetGUID() const { return id; }
+		float GetPositionX() const { return x; }
+		float GetPositionY() const { return y; }
+		float GetPositionZ() const { return z; }
+		float GetObjectBoundingRadius() const { return 0.0f; }
+		MapGridRef& GetMapGridRef() { return gridRef; }
+		MapRegionRef& GetMapRegionRef() { return regionRef; }
+
+		float GetDistance(VisibilityObject const* other) const
+		{
+			float dx = x - other->x, dy = y - other->y, dz = z - other->z;
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		}
+	};
+
+	typedef VisibilityRegion<VisibilityObject> SceneRegion;
+
+	class VisibilityScene
+	{
+	public:
+		VisibilityScene(uint32 players, float area, bool moving)
+			: m_rng(VISIBILITY_SEED), m_objects(players), m_grid(VISIBILITY_DISTANCE), m_area(area), m_moving(moving), m_time(0)
+		{
+			std::uniform_real_distribution<float> position(0.0f, area);
+			for (uint32 i = 0; i < players; ++i)
+			{
+				VisibilityObject& obj = m_objects[i];
+				obj.id = i;
+				obj.x = position(m_rng);
+				obj.y = position(m_rng);
+				obj.z = 0.0f;
+				m_grid.Insert(&obj);
+				MapVisibility::AddToRegion(&obj, DEFAULT_MAP_REGION_SIZE, m_regions, m_regionIndex);
+			}
+		}
+
+		void Move()
+		{
+			m_time += VISIBILITY_TICK;
+			if (!m_moving)
+				return;
+
+			std::uniform_real_distribution<float> step(-VISIBILITY_STEP, VISIBILITY_STEP);
+			for (size_t i = m_rng() % 10; i < m_objects.size(); i += 10)
+			{
+				VisibilityObject& obj = m_objects[i];
+				obj.x = std::min(std::max(obj.x + step(m_rng), 0.0f), m_area);
+				obj.y = std::min(std::max(obj.y + step(m_rng), 0.0f), m_area);
+			}
+		}
+
+		/// the loop Map::Update ran before the grid, every player against every other one
+		void UpdateBruteForce()
+		{
+			for (size_t i = 0; i < m_objects.size(); ++i)
+			{
+				VisibilityObject& obj = m_objects[i];
+				for (size_t j = 0; j < m_objects.size(); ++j)
+				{
+					if (i == j)
+						continue;
+
+					VisibilityObject& other = m_objects[j];
+					if (obj.GetDistance(&other) <= VISIBILITY_DISTANCE)
+						obj.visible.insert(other.id);
+					else
+						obj.visible.erase(other.id);
+				}
+			}
+		}
+
+		/// Map::UpdateVisibility once it had the grid
+		void UpdateGrid()
+		{
+			for (size_t i = 0; i < m_objects.size(); ++i)
+				m_grid.Relocate(&m_objects[i]);
+
+			std::vector<uint32> outOfRange;
+			for (size_t i = 0; i < m_objects.size(); ++i)
+			{
+				VisibilityObject& obj = m_objects[i];
+
+				outOfRange.clear();
+				for (std::set<uint32>::const_iterator itr = obj.visible.begin(); itr != obj.visible.end(); ++itr)
+					if (obj.GetDistance(&m_objects[*itr]) > VISIBILITY_DISTANCE)
+						outOfRange.push_back(*itr);
+				for (size_t j = 0; j < outOfRange.size(); ++j)
+					obj.visible.erase(outOfRange[j]);
+
+				m_grid.VisitRange(obj.x, obj.y, obj.z, VISIBILITY_DISTANCE, [&obj](VisibilityObject* other)
+				{
+					if (other != &obj && obj.GetDistance(other) <= VISIBILITY_DISTANCE)
+						obj.visible.insert(other->id);
+				});
+			}
+		}
+
+		/// Map::UpdateVisibility before the flat lists, only for players who moved far enough, both directions at once
+		void UpdateIncremental()
+		{
+			std::vector<VisibilityObject*> due;
+			for (size_t i = 0; i < m_objects.size(); ++i)
+			{
+				VisibilityObject& obj = m_objects[i];
+				m_grid.Relocate(&obj);
+
+				if (obj.IsVisibilityUpdateDue(m_time, VISIBILITY_NOTIFY_DELAY, VISIBILITY_RELOCATION_LIMIT_SQ))
+				{
+					obj.StartVisibilityUpdate(m_time);
+					due.push_back(&obj);
+				}
+			}
+
+			std::vector<uint32> outOfRange;
+			for (size_t i = 0; i < due.size(); ++i)
+			{
+				VisibilityObject& obj = *due[i];
+
+				outOfRange.clear();
+				for (std::set<uint32>::const_iterator itr = obj.visible.begin(); itr != obj.visible.end(); ++itr)
+					if (obj.GetDistance(&m_objects[*itr]) > VISIBILITY_DISTANCE)
+						outOfRange.push_back(*itr);
+				for (size_t j = 0; j < outOfRange.size(); ++j)
+				{
+					obj.visible.erase(outOfRange[j]);
+					m_objects[outOfRange[j]].visible.erase(obj.id);
+				}
+
+				m_grid.VisitRange(obj.x, obj.y, obj.z, VISIBILITY_DISTANCE, [&obj](VisibilityObject* other)
+				{
+					if (other != &obj && obj.GetDistance(other) <= VISIBILITY_DISTANCE)
+					{
+						obj.visible.insert(other->id);
+						other->visible.insert(obj.id);
+					}
+				});
+			}
+		}
+
+		/// Map::UpdateVisibility without workers, the regions one after another on this thread
+		void UpdateFlat() { UpdatePass(nullptr); }
+
+		/// Map::UpdateVisibility, the regions computed by the workers
+		void UpdateSharded(MapWorkerPool& workers) { UpdatePass(&workers); }
+
+		/// whether every player sees exactly the same players in both scenes
+		bool SameVisibility(VisibilityScene const& other) const
+		{
+			for (size_t i = 0; i < m_objects.size(); ++i)
+			{
+				VisibilityObject::List const& list = m_objects[i].GetVisibleList();
+				VisibilityObject::List const& otherList = other.m_objects[i].GetVisibleList();
+				if (list.size() != otherList.size())
+					return false;
+				for (size_t j = 0; j < list.size(); ++j)
+					if (list[j].guid != otherList[j].guid)
+						return false;
+			}
+			return true;
+		}
+
+		/// whether the lists of this scene hold the players the sets of an incremental scene hold
+		bool SameVisibilityAsSets(VisibilityScene const& incremental) const
+		{
+			for (size_t i = 0; i < m_objects.size(); ++i)
+			{
+				VisibilityObject::List const& list = m_objects[i].GetVisibleList();
+				std::set<uint32> const& set = incremental.m_objects[i].visible;
+				if (list.size() != set.size())
+					return false;
+				std::set<uint32>::const_iterator itr = set.begin();
+				for (size_t j = 0; j < list.size(); ++j, ++itr)
+					if (list[j].guid != *itr)
+						return false;
+			}
+			return true;
+		}
+
+		size_t CountVisible() const
+		{
+			size_t count = 0;
+			for (size_t i = 0; i < m_objects.size(); ++i)
+				count += m_objects[i].visible.size() + m_objects[i].GetVisibleList().size();
+			return count;
+		}
+
+	private:
+		/// Map::HandoffRegions and Map::UpdateVisibility, without the packets Player::FinishVisibilityUpdate builds
+		void UpdatePass(MapWorkerPool* workers)
+		{
+			std::vector<VisibilityObject*> crossing;
+			for (size_t i = 0; i < m_objects.size(); ++i)
+			{
+				VisibilityObject& obj = m_objects[i];
+				m_grid.Relocate(&obj);
+				if (MapVisibility::HasLeftRegion(&obj, DEFAULT_MAP_REGION_SIZE, m_regions))
+					crossing.push_back(&obj);
+			}
+			MapVisibility::HandoffRegions(crossing, DEFAULT_MAP_REGION_SIZE, m_regions, m_regionIndex);
+
+			std::vector<VisibilityObject*> changed;
+			MapVisibility::StartVisibilityPass(m_regions, m_time, VISIBILITY_NOTIFY_DELAY, VISIBILITY_RELOCATION_LIMIT_SQ, changed);
+
+			if (workers)
+			{
+				workers->Run(uint32(m_regions.size()), [this](uint32 index)
+				{
+					MapVisibility::UpdateRegionVisibility(m_regions[index], m_grid, VISIBILITY_DISTANCE);
+				});
+			}
+			else
+			{
+				for (size_t i = 0; i < m_regions.size(); ++i)
+					MapVisibility::UpdateRegionVisibility(m_regions[i], m_grid, VISIBILITY_DISTANCE);
+			}
+
+			MapVisibility::ApplyVisibilityChanges(m_regions, changed);
+
+			for (size_t i = 0; i < changed.size(); ++i)
+			{
+				changed[i]->MergeVisibilityChanges(m_scratch);
+				changed[i]->ClearVisibilityChanges();
+			}
+		}
+
+		std::mt19937 m_rng;
+		std::vector<VisibilityObject> m_objects;
+		MapGrid<VisibilityObject> m_grid;
+		float m_area;
+		bool m_moving;
+		uint32 m_time;
+		std::vector<SceneRegion> m_regions;
+		std::unordered_map<uint32, uint32> m_regionIndex;
+		VisibilityObject::List m_scratch;
+	};
+
+	enum VisibilityMode
+	{
+		VISIBILITY_BRUTE_FORCE,
+		VISIBILITY_GRID,
+		VISIBILITY_INCREMENTAL,
+		VISIBILITY_FLAT,
+	};
+
+	void UpdateScene(VisibilityScene& scene, VisibilityMode mode)
+	{
+		switch (mode)
+		{
+			case VISIBILITY_BRUTE_FORCE: scene.UpdateBruteForce(); break;
+			case VISIBILITY_GRID: scene.UpdateGrid(); break;
+			case VISIBILITY_INCREMENTAL: scene.UpdateIncremental(); break;
+			case VISIBILITY_FLAT: scene.UpdateFlat(); break;
+		}
+	}
+
+	/// kept between runs, the first tick (everyone meeting everyone in range) is not what is measured
+	VisibilityScene& GetScene(uint32 players, bool city, VisibilityMode mode)
+	{
+		static std::map<uint64, std::unique_ptr<VisibilityScene>> scenes;
+		std::unique_ptr<VisibilityScene>& scene = scenes[(uint64(players) << 8) | (uint64(city) << 4) | uint64(mode)];
+		if (!scene)
+		{
+			float area = city ? VISIBILITY_CITY_AREA : VISIBILITY_AREA;
+			scene.reset(new VisibilityScene(players, area, !city));
+			UpdateScene(*scene, mode);
+
+			// the map's pass must agree with the sets it replaced, same players due, both sides of each pair
+			if (mode == VISIBILITY_FLAT)
+			{
+				VisibilityScene incremental(players, area, !city);
+				incremental.UpdateIncremental();
+				for (uint32 i = 0; i < VISIBILITY_CHECK_TICKS; ++i)
+				{
+					if (!scene->SameVisibilityAsSets(incremental))
+					{
+						fprintf(stderr, "Visibility of %u players differs from the incremental update at tick %u\n", players, i);
+						abort();
+					}
+					scene->Move();
+					scene->UpdateFlat();
+					incremental.Move();
+					incremental.UpdateIncremental();
+				}
+			}
+		}
+		return *scene;
+	}
+
+	void RunVisibility(uint32 players, bool city, VisibilityMode mode, uint64 iterations)
+	{
+		VisibilityScene& scene = GetScene(players, city, mode);
+		for (uint64 i = 0; i < iterations; ++i)
+		{
+			scene.Move();
+			UpdateScene(scene, mode);
+		}
+		DoNotOptimize(scene.CountVisible());
+	}
+
+	/// Map::Update with MapUpdate.Threads set to threads. The crowd is run next to a flat scene for a while
+	/// when first built, the lists must not depend on how the regions were spread over the threads.
+	void RunSharded(uint32 players, bool city, uint32 threads, uint64 iterations)
+	{
+		static std::map<uint64, std::unique_ptr<VisibilityScene>> scenes;
+		static MapWorkerPool workers;
+
+		if (workers.GetThreadCount() != threads)
+			workers.Start(threads);
+
+		std::unique_ptr<VisibilityScene>& scene = scenes[(uint64(players) << 16) | (uint64(city) << 8) | uint64(threads)];
+		if (!scene)
+		{
+			float area = city ? VISIBILITY_CITY_AREA : VISIBILITY_AREA;
+			scene.reset(new VisibilityScene(players, area, !city));
+			VisibilityScene flat(players, area, !city);
+			for (uint32 i = 0; i < VISIBILITY_CHECK_TICKS; ++i)
+			{
+				scene->Move();
+				scene->UpdateSharded(workers);
+				flat.Move();
+				flat.UpdateFlat();
+				if (!scene->SameVisibility(flat))
+				{
+					fprintf(stderr, "Visibility of %u players on %u threads differs from the flat update at tick %u\n", players, threads, i);
+					abort();
+				}
+			}
+		}
+
+		for (uint64 i = 0; i < iterations; ++i)
+		{
+			scene->Move();
+			scene->UpdateSharded(workers);
+		}
+		DoNotOptimize(scene->CountVisible());
+	}
+}
+
+#define VISIBILITY_BENCHMARKS(players) \
+	BENCHMARK(Visibility_BruteForce_##players) { RunVisibility(players, false, VISIBILITY_BRUTE_FORCE, iterations); } \
+	BENCHMARK(Visibility_Grid_##players) { RunVisibility(players, false, VISIBILITY_GRID, iterations); } \
+	BENCHMARK(Visibility_Incremental_##players) { RunVisibility(players, false, VISIBILITY_INCREMENTAL, iterations); } \
+	BENCHMARK(Visibility_Flat_##players) { RunVisibility(players, false, VISIBILITY_FLAT, iterations); }
+
+VISIBILITY_BENCHMARKS(100)
+VISIBILITY_BENCHMARKS(500)
+VISIBILITY_BENCHMARKS(1000)
+VISIBILITY_BENCHMARKS(2500)
+VISIBILITY_BENCHMARKS(5000)
+
+/// AFK players in a city, a thousand of them within sight of each other
+BENCHMARK(Visibility_Grid_City_1000) { RunVisibility(1000, true, VISIBILITY_GRID, iterations); }
+BENCHMARK(Visibility_Incremental_City_1000) { RunVisibility(1000, true, VISIBILITY_INCREMENTAL, iterations); }
+BENCHMARK(Visibility_Flat_City_1000) { RunVisibility(1000, true, VISIBILITY_FLAT, iterations); }
+
+/// the map split into regions of DEFAULT_MAP_REGION_SIZE, a 6 by 6 grid of them over the zone
+BENCHMARK(Visibility_Sharded_5000_T1) { RunSharded(5000, false, 1, iterations); }
+BENCHMARK(Visibility_Sharded_5000_T2) { RunSharded(5000, false, 2, iterations); }
+BENCHMARK(Visibility_Sharded_5000_T4) { RunSharded(5000, false, 4, iterations); }
+BENCHMARK(Visibility_Sharded_5000_T8) { RunSharded(5000, false, 8, iterations); }
+/// the whole city in one region, nothing to share
+BENCHMARK(Visibility_Sharded_City_1000_T4) { RunSharded(1000, true, 4, iterations); }
+
+namespace
+{
+	/// positions over a cell of twice the visibility distance, about a quarter of them in range
+	struct PositionBlock
+	{
+		PositionBlock() : x(POSITION_FILTER_COUNT), y(POSITION_FILTER_COUNT), z(POSITION_FILTER_COUNT), hits(POSITION_FILTER_COUNT)
+		{
+			std::mt19937 rng(VISIBILITY_SEED);
+			std::uniform_real_distribution<float> position(-2 * VISIBILITY_DISTANCE, 2 * VISIBILITY_DISTANCE);
+			std::uniform_real_distribution<float> height(-20.0f, 20.0f);
+			for (uint32 i = 0; i < POSITION_FILTER_COUNT; ++i)
+			{
+				x[i] = position(rng);
+				y[i] = position(rng);
+				z[i] = height(rng);
+			}
+		}
+
+		std::vector<float> x, y, z;
+		std::vector<uint32> hits;
+	};
+
+	/// The SIMD kernel must find what the scalar loop finds. Every tail length a vector lane can leave is run,
+	/// around the origin and around positions of the block, which sit exactly at distance zero.
+	void CheckPositionFilter(PositionBlock const& block)
+	{
+		std::vector<uint32> scalar(POSITION_FILTER_COUNT);
+		std::vector<uint32> simd(POSITION_FILTER_COUNT);
+
+		for (uint32 center = 0; center < 4; ++center)
+		{
+			float cx = center ? block.x[center * 97] : 0.0f;
+			float cy = center ? block.y[center * 97] : 0.0f;
+			float cz = center ? block.z[center * 97] : 0.0f;
+
+			for (uint32 tail = 0; tail < 16; ++tail)
+			{
+				for (uint32 count : { tail, POSITION_FILTER_COUNT - tail })
+				{
+					uint32 found = PositionFilter::FilterInRangeScalar(&block.x[0], &block.y[0], &block.z[0], 0, count,
+						cx, cy, cz, VISIBILITY_DISTANCE * VISIBILITY_DISTANCE, &scalar[0]);
+					uint32 simdFound = PositionFilter::FilterInRange(&block.x[0], &block.y[0], &block.z[0], count,
+						cx, cy, cz, VISIBILITY_DISTANCE * VISIBILITY_DISTANCE, &simd[0]);
+					if (found != simdFound || !std::equal(scalar.begin(), scalar.begin() + found, simd.begin()))
+					{
+						fprintf(stderr, "PositionFilter::FilterInRange found %u of %u positions around (%g, %g, %g), the scalar loop %u\n",
+							simdFound, count, cx, cy, cz, found);
+						abort();
+					}
+				}
+			}
+		}
+	}
+
+	PositionBlock& GetPositionBlock()
+	{
+		static PositionBlock block;
+		static bool checked = false;
+		if (!checked)
+		{
+			CheckPositionFilter(block);
+			checked = true;
+		}
+		return block;
+	}
+}
+
+BENCHMARK(PositionFilter_Scalar_4096)
+{
+	PositionBlock& block = GetPositionBlock();
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(PositionFilter::FilterInRangeScalar(&block.x[0], &block.y[0], &block.z[0], 0, POSITION_FILTER_COUNT,
+			0.0f, 0.0f, 0.0f, VISIBILITY_DISTANCE * VISIBILITY_DISTANCE, &block.hits[0]));
+}
+
+/// the widest kernel this build allows, AVX2 only with -mavx2
+BENCHMARK(PositionFilter_Simd_4096)
+{
+	PositionBlock& block = GetPositionBlock();
+	for (uint64 i = 0; i < iterations; ++i)
+		DoNotOptimize(PositionFilter::FilterInRange(&block.x[0], &block.y[0], &block.z[0], POSITION_FILTER_COUNT,
+			0.0f, 0.0f, 0.0f, VISIBILITY_DISTANCE * VISIBILITY_DISTANCE, &block.hits[0]));
+}
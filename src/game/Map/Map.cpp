@@ -1,12 +1,18 @@
 #include "Map.h"
 #include "MapManager.h"
+#include "MapVisibility.h"
 #include "Player.h"
 #include "Log.h"
+#include "Watchdog.h"
+#include "GameClock.h"
 #include "ObjectAccessor.h"
 #include "../World/World.h"
 #include "MapRefManager.h"
 #include "DBStorage/SQLStorages.h"
 
+#include <algorithm>
+#include <cmath>
+
 #define DEFAULT_VISIBILITY_DISTANCE 90.0f
 
 Map::~Map()
@@ -15,8 +21,14 @@ Map::~Map()
 Map::Map(uint32 id, time_t expiry, uint32 InstanceId)
 	: i_mapEntry(sMapEntry.LookupEntry<MapEntry>(id)),
 	i_id(id), i_InstanceId(InstanceId), m_unloadTimer(0),
-	m_VisibleDistance(DEFAULT_VISIBILITY_DISTANCE)
+	m_VisibleDistance(DEFAULT_VISIBILITY_DISTANCE), m_regionsUpdating(false),
+	m_updateTick(0), m_hibernating(false), m_idleTime(0), m_skippedTime(0)
 {
+	InitVisibilityDistance();
+
+	float cellSize = sWorld.getConfig(CONFIG_FLOAT_VISIBILITY_CELL_SIZE);
+	m_playerGrid.SetCellSize(cellSize > 0.0f ? cellSize : m_VisibleDistance);
+	m_regionSize = sWorld.getConfig(CONFIG_FLOAT_MAP_REGION_SIZE);
 }
 void Map::InitVisibilityDistance()
 {
@@ -25,85 +37,185 @@ void Map::InitVisibilityDistance()
 }
 void Map::Update(const uint32& t_diff)
 {
+	++m_updateTick;
+
 	/// update worldsessions for existing players
-	for (m_mapRefIter = m_mapRefManager.begin(); m_mapRefIter != m_mapRefManager.end(); ++m_mapRefIter)
 	{
-		Player* plr = m_mapRefIter->getSource();
-		if (plr && plr->IsInWorld())
+		Origin::WatchdogPhase phase("Map::UpdateSessions");
+		for (m_mapRefIter = m_mapRefManager.begin(); m_mapRefIter != m_mapRefManager.end(); ++m_mapRefIter)
 		{
-			WorldSession* pSession = plr->GetSession();
-			MapSessionFilter updater(pSession);
+			Player* plr = m_mapRefIter->getSource();
+			if (plr && plr->IsInWorld())
+			{
+				WorldSession* pSession = plr->GetSession();
+				MapSessionFilter updater(pSession);
 
-			pSession->Update(updater);
+				pSession->Update(updater);
+			}
 		}
 	}
-	/// update players at tick
-	for (m_mapRefIter = m_mapRefManager.begin(); m_mapRefIter != m_mapRefManager.end(); ++m_mapRefIter)
+	/// move players to the grid cell and region of their new position
 	{
-		Player* plr = m_mapRefIter->getSource();
-		if (plr && plr->IsInWorld())
-		{
-			WorldObject::UpdateHelper helper(plr);
-			helper.Update(t_diff);
-		}
+		Origin::WatchdogPhase phase("Map::HandoffRegions");
+		HandoffRegions();
 	}
-	/// get all player around ?
-	for (m_mapRefIter = m_mapRefManager.begin(); m_mapRefIter != m_mapRefManager.end(); ++m_mapRefIter)
+	/// update players at tick, the regions in parallel
 	{
-		Player* plr = m_mapRefIter->getSource();
-		if (plr && plr->IsInWorld())
-		{
-			for (MapRefManager::iterator m_mapRefIterbis = m_mapRefManager.begin(); m_mapRefIterbis != m_mapRefManager.end(); ++m_mapRefIterbis)
-			{
-				Player* plrbis = m_mapRefIterbis->getSource();
-				if (plrbis && plrbis->IsInWorld() && plr->GetGUID() != plrbis->GetGUID())
-				{
-					
-					float distance = plr->GetDistance(plrbis);
-					if (distance <= 5000)
-					{
-						if (plr->isInList(plrbis->GetGUID()) == false)
-						{
-							plr->addToList(plrbis);
-						}
-					}
-					else
-					{
-						if (plr->isInList(plrbis->GetGUID()) == true)
-						{
-							WorldPacket packet(SMSG_DESTROY_OBJECT, 4);
-							packet << (uint32)plrbis->GetGUIDLow();
-							plr->GetSession()->SendPacket(&packet);
-
-							plr->removeFromList(plrbis->GetGUID());
-						}
-					}
-				}
-			}
-		}
+		Origin::WatchdogPhase phase("Map::UpdatePlayers");
+		UpdateRegions(t_diff);
+	}
+	/// get all player around
+	{
+		Origin::WatchdogPhase phase("Map::UpdateVisibility");
+		UpdateVisibility();
 	}
 	/// for creature
 
+	/// movement and values held back from players further away
+	{
+		Origin::WatchdogPhase phase("Map::SendDeferredUpdates");
+		SendDeferredUpdates();
+	}
+
 	/// Send world objects and item update field changes
-	SendObjectUpdates();
+	{
+		Origin::WatchdogPhase phase("Map::SendObjectUpdates");
+		SendObjectUpdates();
+	}
+
+	UpdateHibernation(t_diff);
 }
-void Map::Remove(Player* player, bool remove)
+bool Map::IsUpdateDue(uint32& diff)
+{
+	m_skippedTime += diff;
+	if (m_hibernating && m_skippedTime < sWorld.getConfig(CONFIG_UINT32_MAP_HIBERNATE_INTERVAL))
+		return false;
+
+	diff = m_skippedTime;
+	m_skippedTime = 0;
+	return true;
+}
+bool Map::HasPendingWork() const
+{
+	return !i_objectsToRemove.empty() || !i_objectsToClientUpdate.empty() || !m_updateData.empty();
+}
+void Map::UpdateHibernation(uint32 diff)
+{
+	if (HavePlayers() || HasPendingWork())
+	{
+		if (m_hibernating)
+			WakeUp();
+		m_idleTime = 0;
+		return;
+	}
+
+	uint32 delay = sWorld.getConfig(CONFIG_UINT32_MAP_HIBERNATE_DELAY);
+	if (m_hibernating || !delay)
+		return;
+
+	m_idleTime += diff;
+	if (m_idleTime >= delay)
+		Hibernate();
+}
+void Map::Hibernate()
 {
-	// destruct for player ?
-	WorldPacket packet(SMSG_DESTROY_OBJECT, 4);
-	packet << (uint32)player->GetGUIDLow();
+	sLog.outDetail("Map %u (instance %u) hibernates", GetId(), GetInstanceId());
+	m_hibernating = true;
+
+	if (!sWorld.getConfig(CONFIG_BOOL_MAP_HIBERNATE_RELEASE_BUFFERS))
+		return;
 
+	// nobody is left to be in a region or a grid cell, give back what the busiest tick needed
+	std::vector<Object*>().swap(i_objectsToClientUpdate);
+	std::vector<Object*>().swap(m_objectsUpdating);
+	UpdateDataMapType().swap(m_updateData);
+	std::vector<MapRegion>().swap(m_regions);
+	std::unordered_map<uint32, uint32>().swap(m_regionIndex);
+	m_playerGrid.ReleaseCells();
+}
+/// The time slept through is passed to the next Update by IsUpdateDue
+void Map::WakeUp()
+{
+	sLog.outDetail("Map %u (instance %u) wakes up", GetId(), GetInstanceId());
+	m_hibernating = false;
+	m_idleTime = 0;
+}
+void Map::HandoffRegions()
+{
+	std::vector<Player*> crossing;
 	for (m_mapRefIter = m_mapRefManager.begin(); m_mapRefIter != m_mapRefManager.end(); ++m_mapRefIter)
 	{
 		Player* plr = m_mapRefIter->getSource();
-		if (player != plr)
+		if (!plr || !plr->IsInWorld())
+			continue;
+
+		m_playerGrid.Relocate(plr);
+
+		if (MapVisibility::HasLeftRegion(plr, m_regionSize, m_regions))
+			crossing.push_back(plr);
+	}
+
+	MapVisibility::HandoffRegions(crossing, m_regionSize, m_regions, m_regionIndex);
+}
+void Map::UpdateRegions(uint32 diff)
+{
+	m_regionsUpdating = true;
+	sMapMgr.GetWorkers().Run(uint32(m_regions.size()), [this, diff](uint32 index)
+	{
+		Origin::WatchdogPhase phase("Map::UpdateRegion", GetId());
+		std::vector<Player*> const& players = m_regions[index].players;
+		for (size_t i = 0; i < players.size(); ++i)
 		{
-			plr->GetSession()->SendPacket(&packet);
+			WorldObject::UpdateHelper helper(players[i]);
+			helper.Update(diff);
 		}
+	});
+	m_regionsUpdating = false;
+
+	// region order, the same whatever thread updated which region
+	for (size_t i = 0; i < m_regions.size(); ++i)
+	{
+		std::vector<Object*>& objects = m_regions[i].objectsToClientUpdate;
+		i_objectsToClientUpdate.insert(i_objectsToClientUpdate.end(), objects.begin(), objects.end());
+		objects.clear();
 	}
+}
+void Map::UpdateVisibility()
+{
+	// positions are those HandoffRegions sorted into the grid, flag every due player before any list is computed
+	std::vector<Player*> changed;
+	MapVisibility::StartVisibilityPass(m_regions, GameClock::GetMSTime(), World::GetRelocationPlayerNotifyDelay(), World::GetRelocationLowerLimitSq(), changed);
+
+	// every region computes the lists of its own players, the grid is only read
+	sMapMgr.GetWorkers().Run(uint32(m_regions.size()), [this](uint32 index)
+	{
+		Origin::WatchdogPhase phase("Map::UpdateRegionVisibility", GetId());
+		MapVisibility::UpdateRegionVisibility(m_regions[index], m_playerGrid, m_VisibleDistance);
+	});
+
+	MapVisibility::ApplyVisibilityChanges(m_regions, changed);
+
+	VisibleList visible;
+	for (size_t i = 0; i < changed.size(); ++i)
+		changed[i]->FinishVisibilityUpdate(visible, m_updateData);
+}
+void Map::Remove(Player* player, bool remove)
+{
+	// visibility is symmetric, only the players seeing this one know it
+	VisibleList const& visible = player->GetVisibleList();
+	for (VisibleList::const_iterator itr = visible.begin(); itr != visible.end(); ++itr)
+	{
+		m_updateData[itr->player].AddOutOfRangeGUID(player->GetObjectGuid());
+		itr->player->removeFromList(player->GetGUID());
+	}
+	m_updateData.erase(player);
 //	if (i_data) // INSTANCE DATA
 //		i_data->OnPlayerLeave(player);
 
+	m_playerGrid.Remove(player);
+	MapVisibility::RemoveFromRegion(player, m_regions);
+	player->LogoutList();
+
 	if (remove)
 		player->CleanupsBeforeDelete();
 	else
@@ -174,14 +286,20 @@ void Map::SendInitSelf(Player *p)
 {
 	if (!p)
 		return;
-	p->BuildCreateUpdateBlockForPlayer(p); // SEND CREATION TO ME !
+	p->SendCreateUpdateToPlayer(p); // SEND CREATION TO ME !
 }
 bool Map::Add(Player* player)
 {
+	if (m_hibernating)
+		WakeUp();
+
 	player->GetMapRef().link(this, player);
 	player->SetMap(this);
 
 	player->AddToWorld();
+	m_playerGrid.Insert(player);
+	MapVisibility::AddToRegion(player, m_regionSize, m_regions, m_regionIndex);
+	player->ForceVisibilityUpdate();
 
 	// init my stats etc and send to me
 	SendInitSelf(player);
@@ -237,15 +355,40 @@ void Map::RemoveAllObjectsInRemoveList()
 		}*/
 	}
 }
+/// Near and mid range first, what is left of the budgets of the observers goes to far range
+void Map::SendDeferredUpdates()
+{
+	for (uint32 pass = 0; pass < 2; ++pass)
+	{
+		for (MapRefManager::iterator itr = m_mapRefManager.begin(); itr != m_mapRefManager.end(); ++itr)
+		{
+			Player* plr = itr->getSource();
+			if (plr && plr->IsInWorld())
+				plr->SendDeferredUpdates(pass == 1, m_updateTick, m_updateData);
+		}
+	}
+}
 void Map::SendObjectUpdates()
 {
+	// objects changing while their update is built are queued again and handled by the next round
 	while (!i_objectsToClientUpdate.empty())
 	{
-		Object* obj = *i_objectsToClientUpdate.begin();
-		i_objectsToClientUpdate.erase(i_objectsToClientUpdate.begin());
-		// COMPLETLY TEMPORARY !!!!!
-		obj->UpdateObject();
-		//SendInitSelf((Player*)obj);
-		//obj->BuildUpdateData(update_players);
+		m_objectsUpdating.swap(i_objectsToClientUpdate);
+		for (size_t i = 0; i < m_objectsUpdating.size(); ++i)
+			if (Object* obj = m_objectsUpdating[i])
+				obj->UpdateObject(m_updateData);
+		m_objectsUpdating.clear();
+	}
+
+	// one packet per player with everything of the tick, visibility changes included
+	for (UpdateDataMapType::iterator itr = m_updateData.begin(); itr != m_updateData.end(); ++itr)
+	{
+		if (!itr->second.HasData())
+			continue;
+
+		WorldPacket packet;
+		itr->second.BuildPacket(&packet);
+		itr->first->GetSession()->SendPacket(&packet);
 	}
+	m_updateData.clear();
 }
\ No newline at end of file
@@ -7,14 +7,30 @@
 #include "../Object/Object.h"
 #include "../Server/SharedDefine.h"
 #include "MapRefManager.h"
+#include "MapGrid.h"
+#include "MapRegion.h"
 #include "../Server/DBStorage/DBStorageStructure.h"
 #include "../Util/Timer.h"
 
+#include <algorithm>
 #include <bitset>
+#include <unordered_map>
+#include <vector>
 
 class Unit;
 class WorldPacket;
 
+/// Cost of Map::Update as measured by MapManager, times in microseconds
+struct MapUpdateStats
+{
+	MapUpdateStats() : count(0), totalTime(0), maxTime(0), lastTime(0) {}
+
+	uint32 count;
+	uint64 totalTime;
+	uint32 maxTime;
+	uint32 lastTime;
+};
+
 class Map
 {
 	friend class MapReference;
@@ -34,6 +50,7 @@ public:
 	}
 	void Update(const uint32&);
 	uint32 GetId(void) const { return i_id; }
+	uint32 GetInstanceId() const { return i_InstanceId; }
 	bool Instanceable() const { return i_mapEntry && i_mapEntry->Instanceable(); }
 	bool IsDungeon() const { return i_mapEntry && i_mapEntry->IsDungeon(); }
 	bool IsRaid() const { return i_mapEntry && i_mapEntry->IsRaid(); }
@@ -47,6 +64,26 @@ public:
 	PlayerList const& GetPlayers() const { return m_mapRefManager; }
 	bool HavePlayers() const { return !m_mapRefManager.isEmpty(); }
 
+	MapUpdateStats const& GetUpdateStats() const { return m_updateStats; }
+	void AddUpdateTime(uint32 usTime)
+	{
+		++m_updateStats.count;
+		m_updateStats.totalTime += usTime;
+		m_updateStats.lastTime = usTime;
+		if (usTime > m_updateStats.maxTime)
+			m_updateStats.maxTime = usTime;
+	}
+	void ResetUpdateStats() { m_updateStats = MapUpdateStats(); }
+
+	/// Counts the updates of the map, observers are due for deferred updates on some ticks only
+	uint32 GetUpdateTick() const { return m_updateTick; }
+
+	/// Maps without players and nothing pending hibernate after MapUpdate.HibernateDelay, MapManager then
+	/// only updates them every MapUpdate.HibernateInterval. The first player added wakes them up.
+	bool IsHibernating() const { return m_hibernating; }
+	/// Whether MapManager updates the map this tick, diff becomes the time since its last update
+	bool IsUpdateDue(uint32& diff);
+
 	virtual bool Add(Player*);
 	virtual void Remove(Player*, bool);
 	template<class T> void Add(T*);
@@ -58,18 +95,41 @@ public:
 
 	void	SendInitSelf(Player*);
 
-	void AddUpdateObject(Object* obj)
+	/// Only called once per tick and object, Object::m_objectUpdated tells whether it is queued already.
+	/// While regions update, objects are queued in their own region and merged afterwards.
+	void AddUpdateObject(WorldObject* obj)
 	{
-		i_objectsToClientUpdate.insert(obj);
+		if (m_regionsUpdating)
+		{
+			ORIGIN_ASSERT(obj->GetMapRegionRef().IsInRegion());
+			m_regions[obj->GetMapRegionRef().region].objectsToClientUpdate.push_back(obj);
+		}
+		else
+			i_objectsToClientUpdate.push_back(obj);
 	}
 
-	void RemoveUpdateObject(Object* obj)
+	/// Rare, the slot is cleared rather than erased so the queue keeps its order
+	void RemoveUpdateObject(WorldObject* obj)
 	{
-		i_objectsToClientUpdate.erase(obj);
+		std::vector<Object*>::iterator itr = std::find(i_objectsToClientUpdate.begin(), i_objectsToClientUpdate.end(), obj);
+		if (itr != i_objectsToClientUpdate.end())
+			*itr = nullptr;
 	}
+	MapGrid<Player> const& GetPlayerGrid() const { return m_playerGrid; }
+	uint32 GetRegionCount() const { return uint32(m_regions.size()); }
 private:
+	void HandoffRegions();
+	void UpdateRegions(uint32 diff);
+	void UpdateVisibility();
+	void SendDeferredUpdates();
 	void SendObjectUpdates();
-	std::set<Object*> i_objectsToClientUpdate;
+	bool HasPendingWork() const;
+	void UpdateHibernation(uint32 diff);
+	void Hibernate();
+	void WakeUp();
+	std::vector<Object*> i_objectsToClientUpdate;       // objects with changed fields, swapped out by SendObjectUpdates
+	std::vector<Object*> m_objectsUpdating;
+	UpdateDataMapType m_updateData;                     // per player, filled during the tick and sent by SendObjectUpdates
 protected:
 	MapRefManager m_mapRefManager;
 	MapRefManager::iterator m_mapRefIter;
@@ -79,6 +139,16 @@ protected:
 	uint32 m_unloadTimer;
 	float m_VisibleDistance;
 	std::set<WorldObject*> i_objectsToRemove;
+	MapGrid<Player> m_playerGrid;                       // players in world and their positions, visibility only looks at neighbouring cells
+	float m_regionSize;
+	std::vector<MapRegion> m_regions;                   // in the order they were first entered, released by Hibernate
+	std::unordered_map<uint32, uint32> m_regionIndex;   // key to index in m_regions
+	bool m_regionsUpdating;                             // regions run in parallel, see AddUpdateObject
+	MapUpdateStats m_updateStats;
+	uint32 m_updateTick;
+	bool m_hibernating;
+	uint32 m_idleTime;                                  // without players and pending work, see UpdateHibernation
+	uint32 m_skippedTime;                               // ticks not passed to Update yet, see IsUpdateDue
 };
 
 class WorldMap : public Map
@@ -0,0 +1,180 @@
+#ifndef ORIGIN_MAPGRID_H
+#define ORIGIN_MAPGRID_H
+
+#include "Common.h"
+#include "PositionFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#define MAP_GRID_NO_CELL        0xFFFFFFFF
+// cell coordinates are 16 bit, centered on the map origin
+#define MAP_GRID_CELL_OFFSET    0x8000
+#define MAP_GRID_MIN_CELL_SIZE  10.0f
+#define MAP_GRID_FILTER_CHUNK   256         // positions filtered at once by VisitRange
+
+/// Cell and slot of an object in a MapGrid, kept by the object so moving and removing it are O(1)
+struct MapGridRef
+{
+	MapGridRef() : cell(MAP_GRID_NO_CELL), index(0) {}
+
+	bool IsInGrid() const { return cell != MAP_GRID_NO_CELL; }
+
+	uint32 cell;
+	uint32 index;
+};
+
+/// Uniform grid of square cells over the x/y plane of a map.
+/// Only cells which ever held an object exist, so the cell size does not depend on the map bounds.
+/// Every cell keeps the positions of its objects as separate x[], y[], z[] arrays next to the objects,
+/// range queries run the PositionFilter kernel over them and only touch the objects in range.
+/// T needs GetPositionX/Y/Z() and a MapGridRef& GetMapGridRef().
+template<class T>
+class MapGrid
+{
+public:
+	struct Cell
+	{
+		std::vector<float> x, y, z;
+		std::vector<T*> objects;
+
+		uint32 Size() const { return uint32(objects.size()); }
+	};
+
+	explicit MapGrid(float cellSize = 100.0f) { SetCellSize(cellSize); }
+
+	/// Only while the grid is empty, the cells of the objects in it would no longer match
+	void SetCellSize(float cellSize)
+	{
+		m_cellSize = cellSize > MAP_GRID_MIN_CELL_SIZE ? cellSize : MAP_GRID_MIN_CELL_SIZE;
+		m_invCellSize = 1.0f / m_cellSize;
+	}
+	float GetCellSize() const { return m_cellSize; }
+
+	void Insert(T* obj)
+	{
+		MapGridRef& ref = obj->GetMapGridRef();
+		if (ref.IsInGrid())
+			return;
+
+		Link(obj, ref, GetCellId(obj->GetPositionX(), obj->GetPositionY()));
+	}
+
+	void Remove(T* obj)
+	{
+		MapGridRef& ref = obj->GetMapGridRef();
+		if (ref.IsInGrid())
+			Unlink(ref);
+	}
+
+	/// Store the current position of the object, moving it to another cell if needed.
+	/// Range queries see positions as of the last call. Returns true if the cell changed.
+	bool Relocate(T* obj)
+	{
+		MapGridRef& ref = obj->GetMapGridRef();
+		if (!ref.IsInGrid())
+			return false;
+
+		uint32 cell = GetCellId(obj->GetPositionX(), obj->GetPositionY());
+		if (cell == ref.cell)
+		{
+			Cell& current = m_cells[cell];
+			current.x[ref.index] = obj->GetPositionX();
+			current.y[ref.index] = obj->GetPositionY();
+			current.z[ref.index] = obj->GetPositionZ();
+			return false;
+		}
+
+		Unlink(ref);
+		Link(obj, ref, cell);
+		return true;
+	}
+
+	/// Call visitor(T*) for every object whose stored position is within radius (3d) of x, y, z.
+	/// Only reads the grid, map regions query it from several threads at once.
+	template<class Visitor>
+	void VisitRange(float x, float y, float z, float radius, Visitor&& visitor) const
+	{
+		int32 minX = GetCellCoord(x - radius), maxX = GetCellCoord(x + radius);
+		int32 minY = GetCellCoord(y - radius), maxY = GetCellCoord(y + radius);
+		float radiusSq = radius * radius;
+
+		for (int32 cellX = minX; cellX <= maxX; ++cellX)
+		{
+			for (int32 cellY = minY; cellY <= maxY; ++cellY)
+			{
+				typename CellMap::const_iterator itr = m_cells.find(MakeCellId(cellX, cellY));
+				if (itr == m_cells.end() || itr->second.objects.empty())
+					continue;
+
+				Cell const& cell = itr->second;
+				uint32 hits[MAP_GRID_FILTER_CHUNK];
+				for (uint32 base = 0; base < cell.Size(); base += MAP_GRID_FILTER_CHUNK)
+				{
+					uint32 count = std::min<uint32>(cell.Size() - base, MAP_GRID_FILTER_CHUNK);
+					uint32 found = PositionFilter::FilterInRange(&cell.x[base], &cell.y[base], &cell.z[base], count, x, y, z, radiusSq, hits);
+					for (uint32 i = 0; i < found; ++i)
+						visitor(cell.objects[base + hits[i]]);
+				}
+			}
+		}
+	}
+
+	/// cells which ever held an object, empty ones are kept for objects walking back and forth
+	size_t GetCellCount() const { return m_cells.size(); }
+
+	/// Drop every cell, only while the grid is empty
+	void ReleaseCells() { CellMap().swap(m_cells); }
+
+private:
+	typedef std::unordered_map<uint32, Cell> CellMap;
+
+	int32 GetCellCoord(float pos) const
+	{
+		int32 coord = int32(std::floor(pos * m_invCellSize)) + MAP_GRID_CELL_OFFSET;
+		return coord < 0 ? 0 : (coord > 0xFFFF ? 0xFFFF : coord);
+	}
+
+	static uint32 MakeCellId(int32 cellX, int32 cellY) { return (uint32(cellX) << 16) | uint32(cellY); }
+
+	uint32 GetCellId(float x, float y) const { return MakeCellId(GetCellCoord(x), GetCellCoord(y)); }
+
+	void Link(T* obj, MapGridRef& ref, uint32 cellId)
+	{
+		Cell& cell = m_cells[cellId];
+		ref.cell = cellId;
+		ref.index = cell.Size();
+		cell.x.push_back(obj->GetPositionX());
+		cell.y.push_back(obj->GetPositionY());
+		cell.z.push_back(obj->GetPositionZ());
+		cell.objects.push_back(obj);
+	}
+
+	/// swap with the last object of the cell, which takes over the slot
+	void Unlink(MapGridRef& ref)
+	{
+		Cell& cell = m_cells[ref.cell];
+		uint32 last = cell.Size() - 1;
+		cell.x[ref.index] = cell.x[last];
+		cell.y[ref.index] = cell.y[last];
+		cell.z[ref.index] = cell.z[last];
+		cell.objects[ref.index] = cell.objects[last];
+		cell.objects[ref.index]->GetMapGridRef().index = ref.index;
+
+		cell.x.pop_back();
+		cell.y.pop_back();
+		cell.z.pop_back();
+		cell.objects.pop_back();
+
+		ref.cell = MAP_GRID_NO_CELL;
+		ref.index = 0;
+	}
+
+	float m_cellSize;
+	float m_invCellSize;
+	CellMap m_cells;
+};
+
+#endif
@@ -21,9 +21,11 @@
 #include "Config/Singleton.h"
 #include "Database/DatabaseEnv.h"
 #include "Log.h"
+#include "Watchdog.h"
 #include "../World/World.h"
 #include "DBStorage/SQLStorages.h"
 
+#include <chrono>
 
 /*
 #include "MapPersistentStateMgr.h"
@@ -42,7 +44,8 @@ MapManager::MapManager()
 
 MapManager::~MapManager()
 {
-	for (MapMapType::iterator iter = i_maps.begin(); iter != i_maps.end(); ++iter)
+	MapMapType const& maps = Maps();
+	for (MapMapType::const_iterator iter = maps.begin(); iter != maps.end(); ++iter)
 	{
 		sLog.outDetail("Removing map: '%d'", iter->second->GetId());
 		delete iter->second;
@@ -53,23 +56,32 @@ void
 MapManager::Initialize()
 {
 	InitMaxInstanceId();
+
+	m_workers.Start(sWorld.getConfig(CONFIG_UINT32_MAP_UPDATE_THREADS));
+	sLog.outString("Map updates use %u thread(s), regions of %.0f yards", m_workers.GetThreadCount(), sWorld.getConfig(CONFIG_FLOAT_MAP_REGION_SIZE));
 }
 
 void MapManager::InitializeVisibilityDistanceInfo()
 {
-	for (MapMapType::iterator iter = i_maps.begin(); iter != i_maps.end(); ++iter)
+	MapMapType const& maps = Maps();
+	for (MapMapType::const_iterator iter = maps.begin(); iter != maps.end(); ++iter)
 		(*iter).second->InitVisibilityDistance();
 }
 
 /// @param id - MapId of the to be created map. @param obj WorldObject for which the map is to be created. Must be player for Instancable maps.
 Map* MapManager::CreateMap(uint32 id, const WorldObject* obj)
 {
-	Guard _guard(*this);
-
 	const MapEntry* entry = sMapEntry.LookupEntry<MapEntry>(id);
 	if (!entry)
 		return nullptr;
 
+	// the common case, a continent which is loaded already
+	if (!entry->Instanceable())
+		if (Map* m = FindMap(id))
+			return m;
+
+	Guard _guard(*this);
+
 	Map* m;
 	if (entry->Instanceable())
 	{
@@ -87,7 +99,7 @@ Map* MapManager::CreateMap(uint32 id, const WorldObject* obj)
 		{
 			m = new WorldMap(id/*, i_gridCleanUpDelay*/);
 			// add map into container
-			i_maps[MapID(id)] = m;
+			i_maps.Insert(MapID(id), m);
 
 			// non-instanceable maps always expected have saved state
 			//m->CreateInstanceData(true);
@@ -99,33 +111,29 @@ Map* MapManager::CreateMap(uint32 id, const WorldObject* obj)
 
 Map* MapManager::FindMap(uint32 mapid, uint32 instanceId) const
 {
-	Guard guard(*this);
-
-	MapMapType::const_iterator iter = i_maps.find(MapID(mapid, instanceId));
-	if (iter == i_maps.end())
+	Map* map = i_maps.Find(MapID(mapid, instanceId));
+	if (!map)
 		return nullptr;
 
 	// this is a small workaround for transports
-	if (instanceId == 0 && iter->second->Instanceable())
+	if (instanceId == 0 && map->Instanceable())
 	{
 		assert(false);
 		return nullptr;
 	}
 
-	return iter->second;
+	return map;
 }
 
 void MapManager::DeleteInstance(uint32 mapid, uint32 instanceId)
 {
 	Guard _guard(*this);
 
-	MapMapType::iterator iter = i_maps.find(MapID(mapid, instanceId));
-	if (iter != i_maps.end())
+	if (Map* pMap = i_maps.Find(MapID(mapid, instanceId)))
 	{
-		Map* pMap = iter->second;
 		if (pMap->Instanceable())
 		{
-			i_maps.erase(iter);
+			i_maps.Erase(MapID(mapid, instanceId));
 
 			//pMap->UnloadAll(true);
 			delete pMap;
@@ -139,24 +147,42 @@ void MapManager::Update(uint32 diff)
 	if (!i_timer.Passed())
 		return;
 
-	for (MapMapType::iterator iter = i_maps.begin(); iter != i_maps.end(); ++iter)
-		iter->second->Update((uint32)i_timer.GetCurrent());
+	// maps created during the updates are not in this snapshot, they are updated from the next tick on
+	MapMapType const& maps = Maps();
+	for (MapMapType::const_iterator iter = maps.begin(); iter != maps.end(); ++iter)
+	{
+		// hibernating maps sleep through most ticks and get the time they missed once updated
+		uint32 mapDiff = (uint32)i_timer.GetCurrent();
+		if (!iter->second->IsUpdateDue(mapDiff))
+			continue;
+
+		Origin::WatchdogPhase phase("Map::Update", iter->second->GetId());
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		iter->second->Update(mapDiff);
+		iter->second->AddUpdateTime(uint32(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()));
+	}
 
 	// remove all maps which can be unloaded
-	MapMapType::iterator iter = i_maps.begin();
-	while (iter != i_maps.end())
 	{
-		Map* pMap = iter->second;
-		// check if map can be unloaded
-		if (pMap->CanUnload((uint32)i_timer.GetCurrent()))
-		{
-			//pMap->UnloadAll(true);
-			delete pMap;
+		Guard _guard(*this);
 
-			i_maps.erase(iter++);
+		MapMapType const& loaded = Maps();
+		for (MapMapType::const_iterator iter = loaded.begin(); iter != loaded.end(); ++iter)
+		{
+			Map* pMap = iter->second;
+			// check if map can be unloaded
+			if (pMap->CanUnload((uint32)i_timer.GetCurrent()))
+			{
+				// loaded is a replaced snapshot from here on, it outlives the loop
+				i_maps.Erase(iter->first);
+
+				//pMap->UnloadAll(true);
+				delete pMap;
+			}
 		}
-		else
-			++iter;
+
+		// the map updates and their workers are done, nothing looks up maps but this thread
+		i_maps.Reclaim();
 	}
 
 	i_timer.SetCurrent(0);
@@ -164,7 +190,8 @@ void MapManager::Update(uint32 diff)
 
 void MapManager::RemoveAllObjectsInRemoveList()
 {
-	for (MapMapType::iterator iter = i_maps.begin(); iter != i_maps.end(); ++iter)
+	MapMapType const& maps = Maps();
+	for (MapMapType::const_iterator iter = maps.begin(); iter != maps.end(); ++iter)
 		iter->second->RemoveAllObjectsInRemoveList();
 }
 
@@ -180,11 +207,18 @@ void MapManager::UnloadAll()
 	/*for (MapMapType::iterator iter = i_maps.begin(); iter != i_maps.end(); ++iter)
 		iter->second->UnloadAll(true);*/
 
-	while (!i_maps.empty())
+	Guard _guard(*this);
+
+	while (!Maps().empty())
 	{
-		delete i_maps.begin()->second;
-		i_maps.erase(i_maps.begin());
+		MapMapType::const_iterator iter = Maps().begin();
+		Map* pMap = iter->second;
+		i_maps.Erase(iter->first);
+		delete pMap;
 	}
+	i_maps.Reclaim();
+
+	m_workers.Stop();
 }
 
 void MapManager::InitMaxInstanceId()
@@ -202,7 +236,8 @@ void MapManager::InitMaxInstanceId()
 uint32 MapManager::GetNumInstances()
 {
 	uint32 ret = 0;
-	for (MapMapType::iterator itr = i_maps.begin(); itr != i_maps.end(); ++itr)
+	MapMapType const& maps = Maps();
+	for (MapMapType::const_iterator itr = maps.begin(); itr != maps.end(); ++itr)
 	{
 		Map* map = itr->second;
 		if (!map->IsDungeon()) continue;
@@ -214,7 +249,8 @@ uint32 MapManager::GetNumInstances()
 uint32 MapManager::GetNumPlayersInInstances()
 {
 	uint32 ret = 0;
-	for (MapMapType::iterator itr = i_maps.begin(); itr != i_maps.end(); ++itr)
+	MapMapType const& maps = Maps();
+	for (MapMapType::const_iterator itr = maps.begin(); itr != maps.end(); ++itr)
 	{
 		Map* map = itr->second;
 		if (!map->IsDungeon()) continue;
@@ -261,7 +297,7 @@ Map* MapManager::CreateInstance(uint32 id, Player* player)
 	// add a new map object into the registry
 	if (pNewMap)
 	{
-		i_maps[MapID(id, NewInstanceId)] = pNewMap;
+		i_maps.Insert(MapID(id, NewInstanceId), pNewMap);
 		map = pNewMap;
 	}
 
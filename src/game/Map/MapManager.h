@@ -5,6 +5,8 @@
 #include "../Define.h"
 #include "Config/Singleton.h"
 #include "Map.h"
+#include "MapRegistry.h"
+#include "MapWorkerPool.h"
 
 #define MIN_MAP_UPDATE_DELAY    50
 
@@ -12,25 +14,6 @@
 class Transport;
 class BattleGround;
 
-struct MapID
-{
-	explicit MapID(uint32 id) : nMapId(id), nInstanceId(0) {}
-	MapID(uint32 id, uint32 instid) : nMapId(id), nInstanceId(instid) {}
-
-	bool operator<(const MapID& val) const
-	{
-		if (nMapId == val.nMapId)
-			return nInstanceId < val.nInstanceId;
-
-		return nMapId < val.nMapId;
-	}
-
-	bool operator==(const MapID& val) const { return nMapId == val.nMapId && nInstanceId == val.nInstanceId; }
-
-	uint32 nMapId;
-	uint32 nInstanceId;
-};
-
 class MapManager : public Origin::Singleton<MapManager, Origin::ClassLevelLockable<MapManager, std::recursive_mutex> >
 {
 	friend class Origin::OperatorNew<MapManager>;
@@ -40,9 +23,11 @@ class MapManager : public Origin::Singleton<MapManager, Origin::ClassLevelLockab
 	typedef Origin::ClassLevelLockable<MapManager, std::recursive_mutex>::Lock Guard;
 
 public:
-	typedef std::map<MapID, Map* > MapMapType;
+	typedef MapRegistry::MapMapType MapMapType;
 
+	/// Existing continents are found without taking the lock, anything else is created under it
 	Map* CreateMap(uint32, const WorldObject* obj);
+	/// Takes no lock, see MapRegistry
 	Map* FindMap(uint32 mapid, uint32 instanceId = 0) const;
 
 	// only const version for outer users
@@ -109,8 +94,11 @@ public:
 	uint32 GetNumPlayersInInstances();
 
 
-	// get list of all maps
-	const MapMapType& Maps() const { return i_maps; }
+	// get list of all maps, a snapshot which stays valid while maps are added or removed
+	const MapMapType& Maps() const { return i_maps.GetMaps(); }
+
+	/// threads the regions of a map are updated by, see Map::Update
+	MapWorkerPool& GetWorkers() { return m_workers; }
 
 	template<typename Do>
 	void DoForAllMapsWithMapId(uint32 mapId, Do& _do);
@@ -125,8 +113,9 @@ private:
 
 	Map* CreateInstance(uint32 id, Player* player);
 
-	MapMapType i_maps;
+	MapRegistry i_maps;                                 // changed under the class lock, read without it
 	IntervalTimer i_timer;
+	MapWorkerPool m_workers;
 
 	uint32 i_MaxInstanceId;
 };
@@ -134,8 +123,9 @@ private:
 template<typename Do>
 inline void MapManager::DoForAllMapsWithMapId(uint32 mapId, Do& _do)
 {
-	MapMapType::const_iterator start = i_maps.lower_bound(MapID(mapId, 0));
-	MapMapType::const_iterator end = i_maps.lower_bound(MapID(mapId + 1, 0));
+	MapMapType const& maps = Maps();
+	MapMapType::const_iterator start = maps.lower_bound(MapID(mapId, 0));
+	MapMapType::const_iterator end = maps.lower_bound(MapID(mapId + 1, 0));
 	for (MapMapType::const_iterator itr = start; itr != end; ++itr)
 		_do(itr->second);
 }
@@ -0,0 +1,88 @@
+#ifndef ORIGIN_MAPREGION_H
+#define ORIGIN_MAPREGION_H
+
+#include "Common.h"
+
+#include <vector>
+
+#define MAP_REGION_NONE         0xFFFFFFFF
+// 16 bit region coordinates, centered on the map origin like the grid cells
+#define MAP_REGION_OFFSET       0x8000
+#define DEFAULT_MAP_REGION_SIZE 533.33333f          // one terrain tile
+#define MIN_MAP_REGION_SIZE     100.0f
+
+class Object;
+class Player;
+
+/// How often an observer hears of a player it sees, by the distance between them
+enum UpdateLodTier
+{
+	UPDATE_LOD_NEAR = 0,                                // every movement and value change as it happens
+	UPDATE_LOD_MID  = 1,                                // the latest movement and values every Visibility.LOD.MidInterval ticks
+	UPDATE_LOD_FAR  = 2,                                // the latest movement every Visibility.LOD.FarInterval ticks
+};
+
+/// Entry of the visibility lists, which are flat vectors sorted by guid
+template<class T>
+struct VisibleEntry
+{
+	VisibleEntry(uint64 _guid, T* _player) : guid(_guid), player(_player), movementPending(false), valuesPending(false) {}
+
+	bool operator<(VisibleEntry const& other) const { return guid < other.guid; }
+
+	uint64 guid;
+	T* player;
+	// held back from player by the update LOD of the list owner, see Player::SendDeferredUpdates
+	bool movementPending;
+	bool valuesPending;
+};
+typedef VisibleEntry<Player> VisiblePlayer;
+typedef std::vector<VisiblePlayer> VisibleList;
+
+/// Other side of a pair found by the visibility update of source, applied to target once every region is done
+template<class T>
+struct VisibleChange
+{
+	VisibleChange(T* _target, T* _source, bool _inRange) : target(_target), source(_source), inRange(_inRange) {}
+
+	T* target;
+	T* source;
+	bool inRange;
+};
+typedef VisibleChange<Player> VisibilityChange;
+
+/// Region of the map an object is updated by and its slot in it, kept by the object
+struct MapRegionRef
+{
+	MapRegionRef() : region(MAP_REGION_NONE), index(0) {}
+
+	bool IsInRegion() const { return region != MAP_REGION_NONE; }
+
+	uint32 region;
+	uint32 index;
+};
+
+/// What the visibility pass keeps of a region, see MapVisibility
+template<class T>
+struct VisibilityRegion
+{
+	explicit VisibilityRegion(uint32 _key) : key(_key) {}
+
+	uint32 key;                                         // region coordinates, see MapVisibility::GetRegionKey
+	std::vector<T*> players;                            // in the order they were handed to the region
+
+	std::vector<T*> due;                                // visibility is recomputed this tick
+	std::vector<VisibleEntry<T> > visible;              // scratch of the visibility update
+	std::vector<VisibleChange<T> > visibilityChanges;   // to the lists of players in any region
+};
+
+/// Square part of a map. The players of one region are updated together by one thread, anything a
+/// region changes outside of itself is queued here and applied once all regions are done.
+struct MapRegion : public VisibilityRegion<Player>
+{
+	explicit MapRegion(uint32 _key) : VisibilityRegion<Player>(_key) {}
+
+	std::vector<Object*> objectsToClientUpdate;         // changed while the region was updating
+};
+
+#endif
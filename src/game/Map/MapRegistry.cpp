@@ -0,0 +1,42 @@
+#include "MapRegistry.h"
+
+MapRegistry::MapRegistry() : m_maps(new MapMapType())
+{
+}
+
+MapRegistry::~MapRegistry()
+{
+	delete m_maps.load(std::memory_order_relaxed);
+	Reclaim();
+}
+
+void MapRegistry::Insert(MapID const& id, Map* map)
+{
+	MapMapType* maps = new MapMapType(GetMaps());
+	(*maps)[id] = map;
+	Publish(maps);
+}
+
+void MapRegistry::Erase(MapID const& id)
+{
+	if (!Find(id))
+		return;
+
+	MapMapType* maps = new MapMapType(GetMaps());
+	maps->erase(id);
+	Publish(maps);
+}
+
+void MapRegistry::Reclaim()
+{
+	for (size_t i = 0; i < m_retired.size(); ++i)
+		delete m_retired[i];
+
+	m_retired.clear();
+}
+
+void MapRegistry::Publish(MapMapType const* maps)
+{
+	// a lookup may still be reading the old snapshot, it is kept until the owner calls Reclaim
+	m_retired.push_back(m_maps.exchange(maps, std::memory_order_acq_rel));
+}
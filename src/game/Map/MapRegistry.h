@@ -0,0 +1,67 @@
+#ifndef ORIGIN_MAPREGISTRY_H
+#define ORIGIN_MAPREGISTRY_H
+
+#include "Common.h"
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+class Map;
+
+struct MapID
+{
+	explicit MapID(uint32 id) : nMapId(id), nInstanceId(0) {}
+	MapID(uint32 id, uint32 instid) : nMapId(id), nInstanceId(instid) {}
+
+	bool operator<(const MapID& val) const
+	{
+		if (nMapId == val.nMapId)
+			return nInstanceId < val.nInstanceId;
+
+		return nMapId < val.nMapId;
+	}
+
+	bool operator==(const MapID& val) const { return nMapId == val.nMapId && nInstanceId == val.nInstanceId; }
+
+	uint32 nMapId;
+	uint32 nInstanceId;
+};
+
+/// The loaded maps of MapManager. Lookups read an immutable snapshot and take no lock, changes copy
+/// the snapshot and publish the copy. Replaced snapshots are kept until Reclaim, which the owner calls
+/// when no lookup can still be reading one. Only one thread at a time may change the registry.
+class MapRegistry
+{
+public:
+	typedef std::map<MapID, Map*> MapMapType;
+
+	MapRegistry();
+	~MapRegistry();
+
+	/// Valid until the next Reclaim, iterating it is safe while maps are added
+	MapMapType const& GetMaps() const { return *m_maps.load(std::memory_order_acquire); }
+
+	Map* Find(MapID const& id) const
+	{
+		MapMapType const& maps = GetMaps();
+		MapMapType::const_iterator itr = maps.find(id);
+		return itr != maps.end() ? itr->second : nullptr;
+	}
+
+	void Insert(MapID const& id, Map* map);
+	void Erase(MapID const& id);
+	/// Free the replaced snapshots, only when no other thread can be in a lookup or hold GetMaps
+	void Reclaim();
+
+private:
+	MapRegistry(MapRegistry const&);
+	MapRegistry& operator=(MapRegistry const&);
+
+	void Publish(MapMapType const* maps);
+
+	std::atomic<MapMapType const*> m_maps;
+	std::vector<MapMapType const*> m_retired;           // replaced snapshots, freed by Reclaim
+};
+
+#endif
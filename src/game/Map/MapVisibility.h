@@ -0,0 +1,293 @@
+#ifndef ORIGIN_MAPVISIBILITY_H
+#define ORIGIN_MAPVISIBILITY_H
+
+#include "Common.h"
+#include "Timer.h"
+#include "MapGrid.h"
+#include "MapRegion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/// Visibility list of an object and its part in the visibility pass of the map, Player derives from it.
+/// T needs GetGUID(), GetPositionX/Y/Z() and derives from VisibilityTracker<T>.
+template<class T>
+class VisibilityTracker
+{
+public:
+	typedef std::vector<VisibleEntry<T> > List;
+
+	VisibilityTracker() : m_visibilityX(0.0f), m_visibilityY(0.0f), m_visibilityZ(0.0f),
+		m_visibilityTime(0), m_visibilityForced(true), m_visibilityUpdating(false) {}
+
+	/// Held while the list is swapped, other threads reading it take it as well
+	std::mutex		mutexPlayerList;
+
+	/// Players seeing this one and seen by it, only changed by the map thread
+	List const& GetVisibleList() const { return m_visibleList; }
+
+	/// Visibility is recomputed once the object moved sqrt(limitSq) since the last time, at most every
+	/// notifyDelay ms. Standing objects cost a distance check.
+	bool IsVisibilityUpdateDue(uint32 now, uint32 notifyDelay, float limitSq) const
+	{
+		if (m_visibilityForced)
+			return true;
+
+		if (WorldTimer::getMSTimeDiff(m_visibilityTime, now) < notifyDelay)
+			return false;
+
+		T const* self = static_cast<T const*>(this);
+		float dx = self->GetPositionX() - m_visibilityX;
+		float dy = self->GetPositionY() - m_visibilityY;
+		float dz = self->GetPositionZ() - m_visibilityZ;
+		return dx * dx + dy * dy + dz * dz >= limitSq;
+	}
+	void ForceVisibilityUpdate() { m_visibilityForced = true; }
+
+	/// A visibility pass of the map (see MapVisibility): StartVisibilityUpdate for the objects which are due,
+	/// SetVisibleList with the objects in range of each of them (from any thread, one per region),
+	/// QueueVisibilityChange for the changes they made to others and MergeVisibilityChanges for every
+	/// object in changed
+	void StartVisibilityUpdate(uint32 now)
+	{
+		T const* self = static_cast<T const*>(this);
+		m_visibilityX = self->GetPositionX();
+		m_visibilityY = self->GetPositionY();
+		m_visibilityZ = self->GetPositionZ();
+		m_visibilityTime = now;
+		m_visibilityForced = false;
+		m_visibilityUpdating = true;
+	}
+	bool IsUpdatingVisibility() const { return m_visibilityUpdating; }
+
+	/// Swap the list with visible, sorted by guid, and queue the objects which came into range or left it.
+	/// The other side of each pair goes to changes, unless that object is updating itself this pass.
+	void SetVisibleList(List& visible, std::vector<VisibleChange<T> >& changes)
+	{
+		T* self = static_cast<T*>(this);
+
+		// walk both sorted lists side by side, what is only in the old one left the range
+		typename List::const_iterator oldItr = m_visibleList.begin();
+		typename List::iterator newItr = visible.begin();
+		while (oldItr != m_visibleList.end() || newItr != visible.end())
+		{
+			if (newItr == visible.end() || (oldItr != m_visibleList.end() && oldItr->guid < newItr->guid))
+			{
+				m_visibleLeft.push_back(*oldItr);
+				// objects updating themselves this pass find the change on their own
+				if (!oldItr->player->IsUpdatingVisibility())
+					changes.push_back(VisibleChange<T>(oldItr->player, self, false));
+				++oldItr;
+			}
+			else if (oldItr == m_visibleList.end() || newItr->guid < oldItr->guid)
+			{
+				m_visibleEntered.push_back(*newItr);
+				if (!newItr->player->IsUpdatingVisibility())
+					changes.push_back(VisibleChange<T>(newItr->player, self, true));
+				++newItr;
+			}
+			else
+			{
+				// still in range, whatever was held back from it still is
+				newItr->movementPending = oldItr->movementPending;
+				newItr->valuesPending = oldItr->valuesPending;
+				++oldItr;
+				++newItr;
+			}
+		}
+
+		std::lock_guard<std::mutex> guard(mutexPlayerList);
+		m_visibleList.swap(visible);
+	}
+
+	/// Objects getting their first change of the pass are appended to changed
+	void QueueVisibilityChange(T* source, bool inRange, std::vector<T*>& changed)
+	{
+		if (m_visibleEntered.empty() && m_visibleLeft.empty())
+			changed.push_back(static_cast<T*>(this));
+
+		if (inRange)
+			m_visibleEntered.push_back(VisibleEntry<T>(source->GetGUID(), source));
+		else
+			m_visibleLeft.push_back(VisibleEntry<T>(source->GetGUID(), source));
+	}
+
+	/// Merge the changes queued by others into the list, scratch is swapped with it. What came into range
+	/// and what left it this pass stays queued until ClearVisibilityChanges.
+	void MergeVisibilityChanges(List& scratch)
+	{
+		if (!m_visibilityUpdating)
+		{
+			// queued in the order the other objects were updated
+			std::sort(m_visibleEntered.begin(), m_visibleEntered.end());
+			std::sort(m_visibleLeft.begin(), m_visibleLeft.end());
+
+			scratch.clear();
+			std::set_difference(m_visibleList.begin(), m_visibleList.end(), m_visibleLeft.begin(), m_visibleLeft.end(), std::back_inserter(scratch));
+			size_t kept = scratch.size();
+			scratch.insert(scratch.end(), m_visibleEntered.begin(), m_visibleEntered.end());
+			std::inplace_merge(scratch.begin(), scratch.begin() + kept, scratch.end());
+
+			std::lock_guard<std::mutex> guard(mutexPlayerList);
+			m_visibleList.swap(scratch);
+		}
+		m_visibilityUpdating = false;
+	}
+	void ClearVisibilityChanges()
+	{
+		m_visibleEntered.clear();
+		m_visibleLeft.clear();
+	}
+
+protected:
+	List m_visibleList;
+	List m_visibleEntered;                              // changes of the running visibility pass
+	List m_visibleLeft;
+
+private:
+	float m_visibilityX, m_visibilityY, m_visibilityZ;  // where visibility was last recomputed
+	uint32 m_visibilityTime;
+	bool m_visibilityForced;
+	bool m_visibilityUpdating;
+};
+
+/// The regions of a map and the visibility pass over them, Map::UpdateVisibility in steps so the
+/// benchmark runs the same code on its own objects. T is a VisibilityTracker<T> and also needs
+/// GetObjectBoundingRadius(), GetDistance(T const*) and a MapRegionRef& GetMapRegionRef().
+/// Region is a VisibilityRegion<T>, regions are kept in the order they were first entered.
+namespace MapVisibility
+{
+	/// 16 bit region coordinates, centered on the map origin like the grid cells
+	inline uint32 GetRegionKey(float x, float y, float regionSize)
+	{
+		int32 regionX = int32(std::floor(x / regionSize)) + MAP_REGION_OFFSET;
+		int32 regionY = int32(std::floor(y / regionSize)) + MAP_REGION_OFFSET;
+		regionX = regionX < 0 ? 0 : (regionX > 0xFFFF ? 0xFFFF : regionX);
+		regionY = regionY < 0 ? 0 : (regionY > 0xFFFF ? 0xFFFF : regionY);
+		return (uint32(regionX) << 16) | uint32(regionY);
+	}
+
+	template<class T, class Region>
+	void AddToRegion(T* obj, float regionSize, std::vector<Region>& regions, std::unordered_map<uint32, uint32>& regionIndex)
+	{
+		uint32 key = GetRegionKey(obj->GetPositionX(), obj->GetPositionY(), regionSize);
+		std::unordered_map<uint32, uint32>::const_iterator itr = regionIndex.find(key);
+		uint32 index;
+		if (itr == regionIndex.end())
+		{
+			index = uint32(regions.size());
+			regions.push_back(Region(key));
+			regionIndex[key] = index;
+		}
+		else
+			index = itr->second;
+
+		Region& region = regions[index];
+		MapRegionRef& ref = obj->GetMapRegionRef();
+		ref.region = index;
+		ref.index = uint32(region.players.size());
+		region.players.push_back(obj);
+	}
+
+	template<class T, class Region>
+	void RemoveFromRegion(T* obj, std::vector<Region>& regions)
+	{
+		MapRegionRef& ref = obj->GetMapRegionRef();
+		if (!ref.IsInRegion())
+			return;
+
+		// swap with the last object of the region, which takes over the slot
+		std::vector<T*>& players = regions[ref.region].players;
+		players[ref.index] = players.back();
+		players[ref.index]->GetMapRegionRef().index = ref.index;
+		players.pop_back();
+
+		ref = MapRegionRef();
+	}
+
+	template<class T, class Region>
+	bool HasLeftRegion(T* obj, float regionSize, std::vector<Region> const& regions)
+	{
+		MapRegionRef const& ref = obj->GetMapRegionRef();
+		return ref.IsInRegion() && regions[ref.region].key != GetRegionKey(obj->GetPositionX(), obj->GetPositionY(), regionSize);
+	}
+
+	/// Move the objects which left their region to the one they are in now, in guid order so the
+	/// regions do not depend on the order the objects were found in
+	template<class T, class Region>
+	void HandoffRegions(std::vector<T*>& crossing, float regionSize, std::vector<Region>& regions, std::unordered_map<uint32, uint32>& regionIndex)
+	{
+		std::sort(crossing.begin(), crossing.end(), [](T const* a, T const* b) { return a->GetGUID() < b->GetGUID(); });
+		for (size_t i = 0; i < crossing.size(); ++i)
+		{
+			RemoveFromRegion(crossing[i], regions);
+			AddToRegion(crossing[i], regionSize, regions, regionIndex);
+		}
+	}
+
+	/// Flag every due object before any list is computed, they are all appended to changed
+	template<class T, class Region>
+	void StartVisibilityPass(std::vector<Region>& regions, uint32 now, uint32 notifyDelay, float limitSq, std::vector<T*>& changed)
+	{
+		for (size_t i = 0; i < regions.size(); ++i)
+		{
+			Region& region = regions[i];
+			region.due.clear();
+			for (size_t j = 0; j < region.players.size(); ++j)
+			{
+				T* obj = region.players[j];
+				if (obj->IsVisibilityUpdateDue(now, notifyDelay, limitSq))
+				{
+					obj->StartVisibilityUpdate(now);
+					region.due.push_back(obj);
+				}
+			}
+			changed.insert(changed.end(), region.due.begin(), region.due.end());
+		}
+	}
+
+	/// The lists of the due objects of one region, from any thread as the grid is only read and the
+	/// changes to other lists are queued on the region
+	template<class T, class Region>
+	void UpdateRegionVisibility(Region& region, MapGrid<T> const& grid, float visibleDistance)
+	{
+		for (size_t i = 0; i < region.due.size(); ++i)
+		{
+			T* obj = region.due[i];
+
+			// objects which came into range can only be in the neighbouring cells, GetDistance is between the bounding radii
+			// and the grid filters on the positions stored when the grid was relocated, which are the current ones
+			std::vector<VisibleEntry<T> >& visible = region.visible;
+			visible.clear();
+			float searchRadius = visibleDistance + 2 * obj->GetObjectBoundingRadius();
+			grid.VisitRange(obj->GetPositionX(), obj->GetPositionY(), obj->GetPositionZ(), searchRadius, [obj, visibleDistance, &visible](T* other)
+			{
+				if (other != obj && obj->GetDistance(other) <= visibleDistance)
+					visible.push_back(VisibleEntry<T>(other->GetGUID(), other));
+			});
+
+			std::sort(visible.begin(), visible.end());
+			obj->SetVisibleList(visible, region.visibilityChanges);
+		}
+	}
+
+	/// The other side of the pairs, in region order so the result does not depend on the threads.
+	/// Each object in changed is merged afterwards, in the order of changed.
+	template<class T, class Region>
+	void ApplyVisibilityChanges(std::vector<Region>& regions, std::vector<T*>& changed)
+	{
+		for (size_t i = 0; i < regions.size(); ++i)
+		{
+			std::vector<VisibleChange<T> >& changes = regions[i].visibilityChanges;
+			for (size_t j = 0; j < changes.size(); ++j)
+				changes[j].target->QueueVisibilityChange(changes[j].source, changes[j].inRange, changed);
+			changes.clear();
+		}
+	}
+}
+
+#endif
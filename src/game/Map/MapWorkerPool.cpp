@@ -0,0 +1,101 @@
+#include "MapWorkerPool.h"
+#include "Watchdog.h"
+
+MapWorkerPool::MapWorkerPool() : m_task(nullptr), m_count(0), m_next(0), m_pending(0), m_run(0), m_stop(false)
+{
+}
+
+MapWorkerPool::~MapWorkerPool()
+{
+	Stop();
+}
+
+void MapWorkerPool::Start(uint32 threads)
+{
+	Stop();
+
+	m_stop = false;
+	for (uint32 i = 1; i < threads; ++i)
+		m_workers.push_back(std::thread(&MapWorkerPool::WorkerThread, this));
+}
+
+void MapWorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i].join();
+	m_workers.clear();
+}
+
+void MapWorkerPool::Run(uint32 count, Task const& task)
+{
+	if (!count)
+		return;
+
+	// nothing to share, spare the wake up
+	if (m_workers.empty() || count == 1)
+	{
+		for (uint32 i = 0; i < count; ++i)
+			task(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_task = &task;
+		m_count = count;
+		m_next = 0;
+		m_pending = count;
+		++m_run;
+	}
+	m_wakeUp.notify_all();
+
+	RunTasks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_pending == 0; });
+	m_task = nullptr;
+}
+
+void MapWorkerPool::RunTasks()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_task && m_next < m_count)
+	{
+		Task const& task = *m_task;
+		uint32 index = m_next++;
+
+		lock.unlock();
+		task(index);
+		lock.lock();
+
+		if (!--m_pending)
+			m_done.notify_all();
+	}
+}
+
+void MapWorkerPool::WorkerThread()
+{
+	Origin::Watchdog::RegisterThread("Map worker", Origin::WATCHDOG_THREAD_MAP);
+
+	uint64 lastRun = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeUp.wait(lock, [this, lastRun] { return m_stop || m_run != lastRun; });
+			if (m_stop)
+				break;
+			lastRun = m_run;
+		}
+
+		RunTasks();
+	}
+
+	Origin::Watchdog::UnregisterThread();
+}
@@ -0,0 +1,55 @@
+#ifndef ORIGIN_MAPWORKERPOOL_H
+#define ORIGIN_MAPWORKERPOOL_H
+
+#include "Common.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define MAP_WORKER_MAX_THREADS  64
+
+/// Threads running the regions of a map update in parallel, see Map::Update.
+/// Run blocks until every task is done and the calling thread takes tasks as well, so a pool
+/// of one thread (the default) runs everything inline. Tasks of one Run must not depend on each other.
+class MapWorkerPool
+{
+public:
+	typedef std::function<void(uint32)> Task;
+
+	MapWorkerPool();
+	~MapWorkerPool();
+
+	/// threads counts the caller, threads - 1 workers are started
+	void Start(uint32 threads);
+	void Stop();
+
+	uint32 GetThreadCount() const { return uint32(m_workers.size()) + 1; }
+
+	/// Call task(0) .. task(count - 1), in any order and on any thread
+	void Run(uint32 count, Task const& task);
+
+private:
+	MapWorkerPool(MapWorkerPool const&);
+	MapWorkerPool& operator=(MapWorkerPool const&);
+
+	void WorkerThread();
+	/// Take tasks of the current run until none is left
+	void RunTasks();
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_done;
+	Task const* m_task;
+	uint32 m_count;
+	uint32 m_next;                                      // first task nobody took yet
+	uint32 m_pending;                                   // tasks not finished yet
+	uint64 m_run;                                       // incremented by every Run, wakes the workers
+	bool m_stop;
+};
+
+#endif
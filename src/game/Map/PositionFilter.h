@@ -0,0 +1,97 @@
+#ifndef ORIGIN_POSITIONFILTER_H
+#define ORIGIN_POSITIONFILTER_H
+
+#include "Common.h"
+
+// the widest kernel the compiler is allowed to emit, there is no runtime dispatch:
+// AVX2 needs /arch:AVX2 (MSVC) or -mavx2, SSE2 is always there on x64
+#if defined(__AVX2__)
+#  define POSITION_FILTER_AVX2
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define POSITION_FILTER_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if COMPILER == COMPILER_MICROSOFT
+#  include <intrin.h>
+#endif
+
+/// Distance filters over positions stored as separate x[], y[], z[] arrays.
+/// They write the indexes of the positions within range (center distance, inclusive) to out, which
+/// must hold count entries, and return how many there are. The order of the indexes is ascending.
+namespace PositionFilter
+{
+	inline uint32 LowestBit(uint32 mask)
+	{
+#if COMPILER == COMPILER_MICROSOFT
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return uint32(index);
+#else
+		return uint32(__builtin_ctz(mask));
+#endif
+	}
+
+	/// positions begin..end-1 one by one, the SIMD kernels use it for their tail
+	inline uint32 FilterInRangeScalar(float const* x, float const* y, float const* z, uint32 begin, uint32 end,
+		float cx, float cy, float cz, float rangeSq, uint32* out)
+	{
+		uint32 found = 0;
+		for (uint32 i = begin; i < end; ++i)
+		{
+			float dx = x[i] - cx;
+			float dy = y[i] - cy;
+			float dz = z[i] - cz;
+			if (dx * dx + dy * dy + dz * dz <= rangeSq)
+				out[found++] = i;
+		}
+		return found;
+	}
+
+	inline uint32 FilterInRange(float const* x, float const* y, float const* z, uint32 count,
+		float cx, float cy, float cz, float rangeSq, uint32* out)
+	{
+		uint32 found = 0;
+		uint32 i = 0;
+
+#if defined(POSITION_FILTER_AVX2)
+		__m256 const centerX = _mm256_set1_ps(cx);
+		__m256 const centerY = _mm256_set1_ps(cy);
+		__m256 const centerZ = _mm256_set1_ps(cz);
+		__m256 const range = _mm256_set1_ps(rangeSq);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), centerX);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), centerY);
+			__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), centerZ);
+			__m256 distSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+			uint32 mask = uint32(_mm256_movemask_ps(_mm256_cmp_ps(distSq, range, _CMP_LE_OQ)));
+			for (; mask; mask &= mask - 1)
+				out[found++] = i + LowestBit(mask);
+		}
+#elif defined(POSITION_FILTER_SSE2)
+		__m128 const centerX = _mm_set1_ps(cx);
+		__m128 const centerY = _mm_set1_ps(cy);
+		__m128 const centerZ = _mm_set1_ps(cz);
+		__m128 const range = _mm_set1_ps(rangeSq);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), centerX);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), centerY);
+			__m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), centerZ);
+			__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			uint32 mask = uint32(_mm_movemask_ps(_mm_cmple_ps(distSq, range)));
+			for (; mask; mask &= mask - 1)
+				out[found++] = i + LowestBit(mask);
+		}
+#endif
+
+		// the tail, or everything without SIMD
+		return found + FilterInRangeScalar(x, y, z, i, count, cx, cy, cz, rangeSq, out + found);
+	}
+}
+
+#endif
@@ -540,30 +540,37 @@ void WorldObject::RemoveFromClientUpdateList()
 {
 	GetMap()->RemoveUpdateObject(this);
 }
-void Object::DestroyForPlayer(Player* target) const
+void Object::DestroyForPlayer(UpdateData* data, Player* target) const
 {
 	ORIGIN_ASSERT(target);
 
-	WorldPacket data(SMSG_DESTROY_OBJECT, 8);
-	data << GetObjectGuid();
-	target->GetSession()->SendPacket(&data);
+	data->AddOutOfRangeGUID(GetObjectGuid());
 }
 void Object::CreateObject()
 {
 	sLog.outError("Unexpected call of Object::CreateObject for object (TypeId: %u Update fields: %u)", GetTypeId(), m_valuesCount);
 	ORIGIN_ASSERT(false);
 }
-void Object::UpdateObject()
+void Object::UpdateObject(UpdateDataMapType& /*updateData*/)
 {
 	sLog.outError("Unexpected call of Object::UpdateObject for object (TypeId: %u Update fields: %u)", GetTypeId(), m_valuesCount);
 	ORIGIN_ASSERT(false);
 }
-void Object::DeleteObject()
+void Object::DeleteObject(UpdateDataMapType& /*updateData*/)
 {
 	sLog.outError("Unexpected call of Object::DeleteObject for object (TypeId: %u Update fields: %u)", GetTypeId(), m_valuesCount);
 	ORIGIN_ASSERT(false);
 }
-void Object::BuildCreateUpdateBlockForPlayer(Player* target) const
+void Object::SendCreateUpdateToPlayer(Player* player) const
+{
+	UpdateData data;
+	BuildCreateUpdateBlockForPlayer(&data, player);
+
+	WorldPacket packet;
+	data.BuildPacket(&packet);
+	player->GetSession()->SendPacket(&packet);
+}
+void Object::BuildCreateUpdateBlockForPlayer(UpdateData* data, Player* target) const
 {
 	if (!target)
 		return;
@@ -593,38 +600,40 @@ void Object::BuildCreateUpdateBlockForPlayer(Player* target) const
 			break;
 		}
 	}
-	WorldPacket pPacket(SMSG_CREATE_OBJECT, 500);
-	pPacket << updatetype;
-	pPacket << updateFlags;
-	pPacket << m_objectTypeId;
-	pPacket << GetName();
+	ByteBuffer buf(500);
+	buf << updatetype;
+	buf << updateFlags;
+	buf << m_objectTypeId;
+	buf << GetName();
 	if (updateFlags != UPDATEFLAG_SELF) /// we don"t need to send our own location as we already did
 	{
-		pPacket << ((WorldObject*)this)->GetPositionX();
-		pPacket << ((WorldObject*)this)->GetPositionY();
-		pPacket << ((WorldObject*)this)->GetPositionZ();
-		pPacket << ((WorldObject*)this)->GetOrientation();
+		buf << ((WorldObject*)this)->GetPositionX();
+		buf << ((WorldObject*)this)->GetPositionY();
+		buf << ((WorldObject*)this)->GetPositionZ();
+		buf << ((WorldObject*)this)->GetOrientation();
 	}
 
-	CreateUpdateCountAndSize(&pPacket, updateFlags); // fill buffer and resize it
-	
-	target->GetSession()->SendPacket(&pPacket);
+	CreateUpdateCountAndSize(&buf, false);
+
+	data->AddUpdateBlock(buf);
 }
-void Object::CreateUpdateCountAndSize(WorldPacket *buf, uint8 updateFlag) const
+void Object::CreateUpdateCountAndSize(ByteBuffer* buf, bool changedOnly) const
 {
-	uint32 oldSize = buf->size();
-	uint32 newsize = 0;
-	
+	// the blocks of an UpdateData follow each other, the count tells where this one ends
+	size_t countPos = buf->wpos();
+	*buf << uint16(0);
+
+	uint16 count = 0;
 	for (uint16 index = 0; index < GetValuesCount(); ++index)
 	{
-		if (GetUInt32Value(index) != 0)
+		if (changedOnly ? m_changedValues[index] : GetUInt32Value(index) != 0)
 		{
-			newsize += 6;
 			*buf << index;
 			*buf << GetUInt32Value(index);
+			++count;
 		}
 	}
-	buf->resize(newsize + oldSize);
+	buf->put<uint16>(countPos, count);
 }
 const char* Object::GetName() const
 {
@@ -639,10 +648,10 @@ const char*	WorldObject::GetName() const
 void WorldObject::CreateObject()
 {
 }
-void WorldObject::UpdateObject()
+void WorldObject::UpdateObject(UpdateDataMapType& /*updateData*/)
 {
 	ClearUpdateMask(false);
 }
-void WorldObject::DeleteObject()
+void WorldObject::DeleteObject(UpdateDataMapType& /*updateData*/)
 {
 }
@@ -24,6 +24,8 @@
 #include "UpdateFields.h"
 #include "UpdateData.h"
 #include "ObjectGuid.h"
+#include "../Map/MapGrid.h"
+#include "../Map/MapRegion.h"
 #include <Timer.h>
 
 #include <set>
@@ -235,8 +237,12 @@ protected:
 	bool m_objectUpdated;
 public:
 	virtual void CreateObject();
-	virtual void UpdateObject();
-	virtual void DeleteObject();
+	/// Add a values block of the changed fields to the UpdateData of every player seeing the object
+	virtual void UpdateObject(UpdateDataMapType& updateData);
+	/// Add the object as out of range to the UpdateData of every player seeing it
+	virtual void DeleteObject(UpdateDataMapType& updateData);
+	/// Send the create block to player at once, instead of with the UpdateData of the map tick
+	void SendCreateUpdateToPlayer(Player* player) const;
 private:
 	bool m_inWorld;
 	bool m_itsNewObject;
@@ -254,8 +260,9 @@ public:
 protected:
 	virtual void AddToClientUpdateList();
 	virtual void RemoveFromClientUpdateList();
-	virtual void BuildCreateUpdateBlockForPlayer(Player* target) const;
-	void CreateUpdateCountAndSize(WorldPacket *buf, uint8 updateFlag) const;
+	virtual void BuildCreateUpdateBlockForPlayer(UpdateData* data, Player* target) const;
+	/// field count, then index and value of every field set (or only the changed ones)
+	void CreateUpdateCountAndSize(ByteBuffer* buf, bool changedOnly) const;
 	void SetUInt32Value(uint16 index, uint32 value);
 	void SetUInt64Value(uint16 index, uint64 value);
 	void SetFloatValue(uint16 index, float value);
@@ -265,7 +272,8 @@ protected:
 	void SetStatFloatValue(uint16 index, float value);
 	void MarkForClientUpdate();
 	void SetStatInt32Value(uint16 index, int32 value);
-	virtual void DestroyForPlayer(Player* target) const;
+	/// The out of range guid for target, with the UpdateData of the map tick like the create block
+	virtual void DestroyForPlayer(UpdateData* data, Player* target) const;
 };
 
 struct WorldObjectChangeAccumulator;
@@ -361,6 +369,11 @@ public:
 
 	virtual void SaveRespawnTime() {}
 
+	/// cell of the object in the MapGrid of its map
+	MapGridRef& GetMapGridRef() { return m_mapGridRef; }
+	/// region of its map the object is updated by
+	MapRegionRef& GetMapRegionRef() { return m_mapRegionRef; }
+
 	bool isActiveObject() const { return m_isActiveObject; }
 	void SetActiveObjectState(bool active);
 	// ASSERT print helper
@@ -380,8 +393,8 @@ protected:
 	std::string m_name;
 
 	void CreateObject() override;
-	void UpdateObject() override;
-	void DeleteObject() override;
+	void UpdateObject(UpdateDataMapType& updateData) override;
+	void DeleteObject(UpdateDataMapType& updateData) override;
 private:
 	Map* m_currMap;                                     // current object's Map location
 	uint32 m_mapId;                                     // object at map with map_id
@@ -389,6 +402,8 @@ private:
 
 	Position m_position;
 	WorldUpdateCounter m_updateTracker;
+	MapGridRef m_mapGridRef;
+	MapRegionRef m_mapRegionRef;
 	bool m_isActiveObject;
 };
 
@@ -7,10 +7,13 @@
 #include "../Server/WorldSession.h"
 #include "UpdateData.h"
 #include "Util.h"
+#include "GameClock.h"
 #include "Database/DatabaseImpl.h"
 #include "DBStorage/SQLStorages.h"
 #include "ObjectMgr.h"
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 
 
 //== Player ====================================================
@@ -24,6 +27,9 @@ Player::Player(WorldSession* session) : Unit()
 
 	m_session = session;
 
+	m_updateBudgetTick = 0;
+	m_updateBudgetUsed = 0;
+
 	if (GetSession()->GetSecurity() >= SEC_GAMEMASTER)
 	{
 	}
@@ -35,16 +41,11 @@ Player::Player(WorldSession* session) : Unit()
 
 	m_logintime = time(nullptr);
 	m_Last_tick = m_logintime;
-	plrList.clear();
 }
 void	Player::LogoutList()
 {
 	std::lock_guard<std::mutex> guard(mutexPlayerList);
-	for (auto it = plrList.begin(); it != plrList.end();)
-	{
-		it = plrList.erase(it++);
-	}
-	plrList.clear();
+	m_visibleList.clear();
 }
 Player::~Player()
 {
@@ -74,20 +75,11 @@ void Player::RemoveFromWorld()
 bool Player::isInList(uint64 guid)
 {
 	std::lock_guard<std::mutex> guard(mutexPlayerList);
-	auto it = plrList.find(guid);
-	if (it == plrList.end())
-	{
+	auto it = std::lower_bound(m_visibleList.begin(), m_visibleList.end(), VisiblePlayer(guid, nullptr));
+	if (it == m_visibleList.end() || it->guid != guid)
 		return false;
-	}
-	if (it->second != NULL)
-	{
-		if (it->second->IsInWorld() == true)
-		{
-			if (it->second->GetGUID() == guid)
-				return true;
-		}
-	}
-	return false;
+
+	return it->player && it->player->IsInWorld();
 }
 /*void Player::checkListClear()
 {
@@ -111,68 +103,180 @@ bool Player::isInList(uint64 guid)
 		}
 	}
 }*/
-void Player::addToList(Player* other)
+void Player::removeFromList(uint64 other)
 {
 	std::lock_guard<std::mutex> guard(mutexPlayerList);
-	plrList.insert(std::make_pair(other->GetGUID(), other));
-	Unit::BuildCreateUpdateBlockForPlayer(other);
-	//sLog.outDebug("Player '%s' has been added to '%s' List", other->GetName(), this->GetName());
+	auto it = std::lower_bound(m_visibleList.begin(), m_visibleList.end(), VisiblePlayer(other, nullptr));
+	if (it != m_visibleList.end() && it->guid == other)
+		m_visibleList.erase(it);
 }
-void Player::removeFromList(uint64 other)
+void Player::FinishVisibilityUpdate(VisibleList& scratch, UpdateDataMapType& updateData)
+{
+	MergeVisibilityChanges(scratch);
+
+	if (m_visibleLeft.empty() && m_visibleEntered.empty())
+		return;
+
+	UpdateData& data = updateData[this];
+	for (size_t i = 0; i < m_visibleLeft.size(); ++i)
+		data.AddOutOfRangeGUID(m_visibleLeft[i].player->GetObjectGuid());
+	for (size_t i = 0; i < m_visibleEntered.size(); ++i)
+		m_visibleEntered[i].player->BuildCreateUpdateBlockForPlayer(&data, this);
+
+	ClearVisibilityChanges();
+}
+void Player::SendToOther(WorldPacket& packet, bool immediate)
 {
 	std::lock_guard<std::mutex> guard(mutexPlayerList);
-	for (auto it = plrList.begin(); it != plrList.end();)
+	for (auto it = m_visibleList.begin(); it != m_visibleList.end(); ++it)
 	{
-		if (it->second != NULL)
+		if (it->player && it->player->IsInWorld())
+			it->player->GetSession()->SendPacket(&packet, immediate);
+	}
+}
+void Player::SendMovementToOther(WorldPacket& packet)
+{
+	uint32 tick = GetMap()->GetUpdateTick();
+
+	std::lock_guard<std::mutex> guard(mutexPlayerList);
+	// refilled in place, the buffer keeps its capacity from the last movement
+	m_lastMovement.Initialize(packet.GetOpcode(), packet.size());
+	m_lastMovement.append(packet.contents(), packet.size());
+	for (auto it = m_visibleList.begin(); it != m_visibleList.end(); ++it)
+	{
+		Player* observer = it->player;
+		if (!observer || !observer->IsInWorld())
+			continue;
+
+		if (GetUpdateLodTier(observer) == UPDATE_LOD_NEAR)
 		{
-			if (it->first == other)
-			{
-				it = plrList.erase(it++);
-				break;
-			}
-			else
-				it++;
+			observer->UseUpdateBudget(tick, uint32(packet.size()), true);
+			observer->GetSession()->SendPacket(&packet);
+			it->movementPending = false;
 		}
+		else
+			it->movementPending = true;
 	}
 }
-void Player::SendToOther(WorldPacket& packet, bool immediate)
+UpdateLodTier Player::GetUpdateLodTier(Player const* observer) const
 {
+	float distance = GetDistance(observer);
+	if (distance <= sWorld.getConfig(CONFIG_FLOAT_VISIBILITY_LOD_NEAR_DISTANCE))
+		return UPDATE_LOD_NEAR;
+	if (distance <= sWorld.getConfig(CONFIG_FLOAT_VISIBILITY_LOD_MID_DISTANCE))
+		return UPDATE_LOD_MID;
+	return UPDATE_LOD_FAR;
+}
+void Player::SendDeferredUpdates(bool farTier, uint32 tick, UpdateDataMapType& updateData)
+{
+	ByteBuffer values;
+	bool pending = false;
+
 	std::lock_guard<std::mutex> guard(mutexPlayerList);
-	for (auto it = plrList.begin(); it != plrList.end();)
+	for (auto it = m_visibleList.begin(); it != m_visibleList.end(); ++it)
 	{
-		if (it->second != NULL)
+		if (!it->movementPending && !it->valuesPending)
+			continue;
+
+		// observers are spread over the ticks of their tier by guid, a near one is due at once
+		Player* observer = it->player;
+		UpdateLodTier tier = GetUpdateLodTier(observer);
+		uint32 interval = tier == UPDATE_LOD_FAR ? sWorld.getConfig(CONFIG_UINT32_VISIBILITY_LOD_FAR_INTERVAL) : sWorld.getConfig(CONFIG_UINT32_VISIBILITY_LOD_MID_INTERVAL);
+		bool due = (tier == UPDATE_LOD_FAR) == farTier && (tier == UPDATE_LOD_NEAR || (tick + observer->GetGUIDLow()) % interval == 0);
+
+		if (due && it->movementPending && observer->UseUpdateBudget(tick, uint32(m_lastMovement.size()), false))
 		{
-			if (it->second->IsInWorld() == true)
+			observer->GetSession()->SendPacket(&m_lastMovement);
+			it->movementPending = false;
+		}
+
+		// far observers only learn where we are, the values wait until they come closer
+		if (due && it->valuesPending && tier != UPDATE_LOD_FAR)
+		{
+			if (values.empty())
+			{
+				values << uint8(UPDATETYPE_VALUES);
+				values << uint8(m_objectTypeId);
+				values << GetGUIDLow();
+
+				size_t countPos = values.wpos();
+				values << uint16(0);
+				uint16 count = 0;
+				for (uint16 index = 0; index < GetValuesCount(); ++index)
+				{
+					if (m_deferredValues[index])
+					{
+						values << index;
+						values << GetUInt32Value(index);
+						++count;
+					}
+				}
+				values.put<uint16>(countPos, count);
+			}
+
+			if (observer->UseUpdateBudget(tick, uint32(values.size()), false))
 			{
-				it->second->GetSession()->SendPacket(&packet, immediate);
+				updateData[observer].AddUpdateBlock(values);
+				it->valuesPending = false;
 			}
 		}
-		it++;
+
+		pending = pending || it->valuesPending;
 	}
+
+	// once nobody waits for them, the fields start over with the next change
+	if (farTier && !pending)
+		std::fill(m_deferredValues.begin(), m_deferredValues.end(), false);
 }
-void Player::UpdateObject()
+bool Player::UseUpdateBudget(uint32 tick, uint32 bytes, bool force)
 {
-	WorldPacket packet(SMSG_UPDATE_OBJECT, 200);
+	if (m_updateBudgetTick != tick)
+	{
+		m_updateBudgetTick = tick;
+		m_updateBudgetUsed = 0;
+	}
 
-	packet << uint8(UPDATETYPE_VALUES);
-	packet << uint8(m_objectTypeId);
-	packet << GetGUIDLow();
+	uint32 budget = sWorld.getConfig(CONFIG_UINT32_VISIBILITY_LOD_TICK_BUDGET);
+	if (!force && budget && m_updateBudgetUsed + bytes > budget)
+		return false;
 
-	uint32 oldSize = packet.size();
-	uint32 newSize = 0;
-	for (uint16 index = 0; index < GetValuesCount(); ++index)
+	m_updateBudgetUsed += bytes;
+	return true;
+}
+void Player::UpdateObject(UpdateDataMapType& updateData)
+{
+	ByteBuffer block(200);
+	block << uint8(UPDATETYPE_VALUES);
+	block << uint8(m_objectTypeId);
+	block << GetGUIDLow();
+	CreateUpdateCountAndSize(&block, true);
+
+	// the same block for ourselves and everyone near, the others get all fields changed since once due
+	uint32 tick = GetMap()->GetUpdateTick();
+	bool deferred = false;
+	std::lock_guard<std::mutex> guard(mutexPlayerList);
+	for (auto it = m_visibleList.begin(); it != m_visibleList.end(); ++it)
 	{
-		if (m_changedValues[index] == true)
+		if (GetUpdateLodTier(it->player) == UPDATE_LOD_NEAR)
+		{
+			it->player->UseUpdateBudget(tick, uint32(block.size()), true);
+			updateData[it->player].AddUpdateBlock(block);
+		}
+		else
 		{
-			newSize += 6;
-			packet << index;
-			packet << GetUInt32Value(index);
+			it->valuesPending = true;
+			deferred = true;
 		}
 	}
-	packet.resize(oldSize + newSize);
-	/// need to iterate over the list
-	SendToOther(packet);
-	GetSession()->SendPacket(&packet);
+	updateData[this].AddUpdateBlock(block);
+
+	if (deferred)
+	{
+		m_deferredValues.resize(GetValuesCount(), false);
+		for (uint16 index = 0; index < GetValuesCount(); ++index)
+			if (m_changedValues[index])
+				m_deferredValues[index] = true;
+	}
 	ClearUpdateMask(false);
 }
 uint32 Player::GetLevelFromDB(uint32 guid)
@@ -215,7 +319,7 @@ void Player::Update(uint32 update_diff, uint32 p_time)
 
 	Unit::Update(update_diff, p_time);
 
-	time_t now = time(nullptr);
+	time_t now = GameClock::GetGameTime();
 
 	// Played time
 	if (now > m_Last_tick)
@@ -608,23 +712,22 @@ void Player::DeleteFromDB(uint32 playerguid, uint32 accountId, bool updateRealmC
 	//if (updateRealmChars)
 		//sWorld.UpdateRealmCharCount(accountId);
 }
-void Player::BuildCreateUpdateBlockForPlayer(Player* target) const
+void Player::BuildCreateUpdateBlockForPlayer(UpdateData* data, Player* target) const
 {
 	if (target == this)
 	{
 		// do item
 	}
-	Unit::BuildCreateUpdateBlockForPlayer(target);
+	Unit::BuildCreateUpdateBlockForPlayer(data, target);
 }
 void Player::CreateObject()
 {
 }
-void Player::DeleteObject()
+void Player::DeleteObject(UpdateDataMapType& updateData)
 {
-	WorldPacket packet(SMSG_DESTROY_OBJECT, 4);
-	packet << GetGUIDLow();
-
-	SendToOther(packet);
+	std::lock_guard<std::mutex> guard(mutexPlayerList);
+	for (auto it = m_visibleList.begin(); it != m_visibleList.end(); ++it)
+		DestroyForPlayer(&updateData[it->player], it->player);
 }
 void Player::_LoadSkills(QueryResult* result)
 {
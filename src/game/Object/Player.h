@@ -6,6 +6,7 @@
 #include "Database/DatabaseEnv.h"
 #include "../Server/WorldSession.h"
 #include "MapReference.h"
+#include "../Map/MapVisibility.h"
 #include "Util.h"                                           // for Tokens typedef
 #include "../Server/SharedDefine.h"
 
@@ -115,7 +116,7 @@ enum PlayerFlags
 	PLAYER_FLAGS_NO_PLAY_TIME = 0x00001000,       // played too long time
 	PLAYER_FLAGS_SANCTUARY = 0x00002000,       // player entered sanctuary
 };
-class Player : public Unit
+class Player : public Unit, public VisibilityTracker<Player>
 {
 	friend class WorldSession;
 public:
@@ -195,27 +196,42 @@ public:
 	/*********************************************************/
 	/***                  LIST  SYSTEM                     ***/
 	/*********************************************************/
-	std::mutex		mutexPlayerList;
 	void			LogoutList();
 	bool			isInList(uint64 guid);
-	void			addToList(Player*);
 	void			removeFromList(uint64);
 	//void			checkListClear();
 	void			SendToOther(WorldPacket &packet, bool immediate = false);
+	/// Near observers get the packet at once, the others only the latest movement once their tier is due
+	void			SendMovementToOther(WorldPacket& packet);
+	/// By Visibility.LOD.NearDistance and Visibility.LOD.MidDistance
+	UpdateLodTier	GetUpdateLodTier(Player const* observer) const;
+	/// Send the movement and values held back from the observers of the near and mid tiers, or the far
+	/// tier, which are due at tick and have the budget left. Far observers only get the movement.
+	void			SendDeferredUpdates(bool farTier, uint32 tick, UpdateDataMapType& updateData);
+	/// Charge bytes sent to this player during tick against Visibility.LOD.TickBudget, forced ones
+	/// (near traffic) are always sent and only use the budget up
+	bool			UseUpdateBudget(uint32 tick, uint32 bytes, bool force);
+
+	/// The end of the visibility pass (see VisibilityTracker): merge the changes queued by others into the list,
+	/// scratch is swapped with it, and add the out of range guids and create blocks of the pass to the UpdateData
+	void			FinishVisibilityUpdate(VisibleList& scratch, UpdateDataMapType& updateData);
 
 	/*********************************************************/
 	/***                UPDATE  SYSTEM                     ***/
 	/*********************************************************/
 public:
-	void BuildCreateUpdateBlockForPlayer(Player* target) const override;
+	void BuildCreateUpdateBlockForPlayer(UpdateData* data, Player* target) const override;
 
 	void CreateObject() override;
-	void UpdateObject() override;
-	void DeleteObject() override;
+	void UpdateObject(UpdateDataMapType& updateData) override;
+	void DeleteObject(UpdateDataMapType& updateData) override;
 
 private:
 	MapReference								m_mapRef;
-	std::map<uint64, Player*>					plrList;
+	WorldPacket									m_lastMovement;         // sent to observers further away once due
+	std::vector<bool>							m_deferredValues;       // changed while an observer was held back
+	uint32										m_updateBudgetTick;
+	uint32										m_updateBudgetUsed;     // bytes sent to this player during m_updateBudgetTick
 	uint32										guildID;
 
 	/*********************************************************/
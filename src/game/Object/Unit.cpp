@@ -282,11 +282,11 @@ void Unit::ApplyMaxPowerMod(Powers power, uint32 val, bool apply)
 void Unit::CreateObject()
 {
 }
-void Unit::UpdateObject()
+void Unit::UpdateObject(UpdateDataMapType& /*updateData*/)
 {
 	ClearUpdateMask(false);
 }
-void Unit::DeleteObject()
+void Unit::DeleteObject(UpdateDataMapType& /*updateData*/)
 {
 }
 void Unit::UpdateSpeed(UnitMoveType mtype, bool forced, float ratio)
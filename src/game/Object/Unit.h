@@ -144,8 +144,8 @@ public:
 	bool isDead() const { return (m_deathState == DEAD || m_deathState == CORPSE); };
 
 	void CreateObject() override;
-	void UpdateObject() override;
-	void DeleteObject() override;
+	void UpdateObject(UpdateDataMapType& updateData) override;
+	void DeleteObject(UpdateDataMapType& updateData) override;
 
 	void		UpdateSpeed(UnitMoveType mtype, bool forced, float ratio = 1.0f);
 	float		GetSpeed(UnitMoveType mtype) const;
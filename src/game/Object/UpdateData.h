@@ -29,6 +29,28 @@ enum ObjectUpdateFlags
 	UPDATEFLAG_HAS_POSITION = 0x0040
 };
 
+/// Everything one player learns about other objects in a tick, sent as a single SMSG_UPDATE_OBJECT.
+/// Creates and destroys travel in it as well, the server no longer sends SMSG_CREATE_OBJECT or
+/// SMSG_DESTROY_OBJECT, not even for the self-create at login. Little endian, names null terminated:
+///
+///   uint32  blocks          update blocks that follow, the out of range block included
+///   uint8   transport       1 if the receiver is on a transport, else 0
+///   out of range block, only if guids left the range:
+///     uint8   UPDATETYPE_OUT_OF_RANGE_OBJECTS
+///     uint32  count
+///     count x packed guid     uint8 mask of the nonzero bytes of the full 64 bit guid, then those bytes low to high
+///   then per block one of:
+///     create (UPDATETYPE_CREATE_OBJECT):
+///       uint8   type, uint8 ObjectUpdateFlags, uint8 TypeID, string name
+///       float   x, y, z, orientation      left out when the flags are UPDATEFLAG_SELF
+///       uint16  fields, then fields x (uint16 index, uint32 value), the nonzero values
+///     values (UPDATETYPE_VALUES):
+///       uint8   type, uint8 TypeID, uint32 guid low
+///       uint16  fields, then fields x (uint16 index, uint32 value), the changed values
+///
+/// A client must read blocks until the count is reached, no longer until the end of the packet. It takes
+/// the field count from the block instead of the packet size, drops the objects of the out of range
+/// block, and expects its own player as a create block with UPDATEFLAG_SELF.
 class UpdateData
 {
 public:
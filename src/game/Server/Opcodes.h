@@ -34,9 +34,9 @@ enum OpcodesList
 	SMSG_LOGIN_VERIFY_WORLD = 0x012,
 	SMSG_LOGIN_FINISHED = 0x013,
 	CMSG_ENTER_WORLD_FINISHED = 0x014,
-	SMSG_CREATE_OBJECT = 0x015,
-	SMSG_UPDATE_OBJECT = 0x016,
-	SMSG_DESTROY_OBJECT = 0x017,
+	SMSG_CREATE_OBJECT = 0x015,	// NOT SENT, CREATES ARE BLOCKS OF SMSG_UPDATE_OBJECT
+	SMSG_UPDATE_OBJECT = 0x016,	// BATCHED OBJECT UPDATES, LAYOUT IN UpdateData.h
+	SMSG_DESTROY_OBJECT = 0x017,	// NOT SENT, DESTROYS ARE THE OUT OF RANGE BLOCK OF SMSG_UPDATE_OBJECT
 
 	MSG_MOVEMENT = 0x018,
 	MSG_RECLOCATE = 0x019,
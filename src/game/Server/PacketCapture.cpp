@@ -0,0 +1,236 @@
+#include "PacketCapture.h"
+#include "WorldSession.h"
+#include "WorldPacket.h"
+#include "../World/World.h"
+#include <Util/ByteConverter.h>
+#include <Timer.h>
+#include <Log.h>
+
+#include <cstring>
+
+INSTANTIATE_SINGLETON_1(PacketCapture);
+INSTANTIATE_SINGLETON_1(PacketReplay);
+
+bool PacketCapture::Start(std::string const& fileName)
+{
+	if (m_file)
+		return false;
+
+	m_file = fopen(fileName.c_str(), "wb");
+	if (!m_file)
+	{
+		sLog.outError("PacketCapture: can not create capture file %s", fileName.c_str());
+		return false;
+	}
+
+	PacketCaptureHeader header;
+	header.magic = PACKET_CAPTURE_MAGIC;
+	header.version = PACKET_CAPTURE_VERSION;
+	header.startTime = uint64(time(nullptr));
+	EndianConvert(header.magic);
+	EndianConvert(header.version);
+	EndianConvert(header.startTime);
+	fwrite(&header, sizeof(header), 1, m_file);
+
+	{
+		std::lock_guard<std::mutex> guard(m_bufferLock);
+		m_buffer.clear();
+	}
+	m_startTime = std::chrono::steady_clock::now();
+	m_startTick = World::m_worldLoopCounter;
+	m_records = 0;
+	m_dropped = 0;
+
+	// everything above must be visible before the network threads see the flag
+	m_capturing.store(true, std::memory_order_release);
+
+	sLog.outString("PacketCapture: capturing inbound packets to %s", fileName.c_str());
+	return true;
+}
+
+void PacketCapture::Stop()
+{
+	if (!m_file)
+		return;
+
+	m_capturing.store(false, std::memory_order_release);
+	Flush();
+
+	fclose(m_file);
+	m_file = nullptr;
+
+	sLog.outString("PacketCapture: capture stopped, " UI64FMTD " packets written, " UI64FMTD " dropped", m_records.load(), m_dropped.load());
+}
+
+void PacketCapture::Capture(uint64 session, uint32 accountId, WorldPacket const& packet)
+{
+	PacketCaptureRecord record;
+	record.time = uint64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime).count());
+	record.session = session;
+	record.tick = World::m_worldLoopCounter - m_startTick;
+	record.accountId = accountId;
+	record.opcode = uint16(packet.GetOpcode());
+	record.size = uint16(packet.size());
+	EndianConvert(record.time);
+	EndianConvert(record.session);
+	EndianConvert(record.tick);
+	EndianConvert(record.accountId);
+	EndianConvert(record.opcode);
+	EndianConvert(record.size);
+
+	std::lock_guard<std::mutex> guard(m_bufferLock);
+
+	// the world thread is not keeping up (or hangs), do not grow without bounds
+	if (m_buffer.size() + sizeof(record) + packet.size() > PACKET_CAPTURE_MAX_PENDING)
+	{
+		++m_dropped;
+		return;
+	}
+
+	char const* recordData = reinterpret_cast<char const*>(&record);
+	m_buffer.insert(m_buffer.end(), recordData, recordData + sizeof(record));
+	if (packet.size())
+		m_buffer.insert(m_buffer.end(), reinterpret_cast<char const*>(packet.contents()), reinterpret_cast<char const*>(packet.contents()) + packet.size());
+	++m_records;
+}
+
+void PacketCapture::Flush()
+{
+	if (!m_file)
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(m_bufferLock);
+		m_writeBuffer.swap(m_buffer);
+	}
+
+	if (m_writeBuffer.empty())
+		return;
+
+	if (fwrite(&m_writeBuffer[0], m_writeBuffer.size(), 1, m_file) != 1)
+		sLog.outError("PacketCapture: write of " SIZEFMTD " bytes failed", m_writeBuffer.size());
+	m_writeBuffer.clear();
+}
+
+bool PacketReplay::Start(std::string const& fileName, Timing timing)
+{
+	if (m_file)
+		return false;
+
+	m_file = fopen(fileName.c_str(), "rb");
+	if (!m_file)
+	{
+		sLog.outError("PacketReplay: can not open capture file %s", fileName.c_str());
+		return false;
+	}
+
+	PacketCaptureHeader header;
+	bool valid = fread(&header, sizeof(header), 1, m_file) == 1;
+	EndianConvert(header.magic);
+	EndianConvert(header.version);
+	if (!valid || header.magic != PACKET_CAPTURE_MAGIC || header.version != PACKET_CAPTURE_VERSION)
+	{
+		sLog.outError("PacketReplay: %s is not a packet capture (or of an unsupported version)", fileName.c_str());
+		fclose(m_file);
+		m_file = nullptr;
+		return false;
+	}
+
+	m_fileName = fileName;
+	m_timing = timing;
+	m_tick = 0;
+	m_time = 0;
+	m_startMSTime = 0;
+	m_packets = 0;
+	m_sessions.clear();
+	m_hasNext = ReadNext();
+	m_firstTick = m_hasNext ? m_next.tick : 0;
+	m_firstTime = m_hasNext ? m_next.time : 0;
+
+	sLog.outString("PacketReplay: replaying %s by %s", fileName.c_str(), timing == REPLAY_TIMING_TICK ? "world tick" : "time");
+	return true;
+}
+
+void PacketReplay::Stop()
+{
+	if (!m_file)
+		return;
+
+	fclose(m_file);
+	m_file = nullptr;
+	m_hasNext = false;
+	m_sessions.clear();
+}
+
+bool PacketReplay::ReadNext()
+{
+	if (fread(&m_next, sizeof(m_next), 1, m_file) != 1)
+		return false;
+
+	EndianConvert(m_next.time);
+	EndianConvert(m_next.session);
+	EndianConvert(m_next.tick);
+	EndianConvert(m_next.accountId);
+	EndianConvert(m_next.opcode);
+	EndianConvert(m_next.size);
+
+	m_nextPayload.resize(m_next.size);
+	if (m_next.size && fread(&m_nextPayload[0], m_next.size, 1, m_file) != 1)
+	{
+		sLog.outError("PacketReplay: %s is truncated after " UI64FMTD " packets", m_fileName.c_str(), m_packets);
+		return false;
+	}
+
+	return true;
+}
+
+void PacketReplay::QueueNext()
+{
+	// one socketless session per captured login, created again if it was kicked meanwhile
+	SessionHandle& handle = m_sessions[m_next.session];
+	WorldSession* session = sSessionTable.Resolve(handle);
+	if (!session)
+	{
+		session = new WorldSession(m_next.accountId, nullptr, AccountTypes(AccountTypes::SEC_PLAYER), 0, LOCALE_enUS);
+		handle = session->GetHandle();
+		sWorld.AddSession(session);
+	}
+
+	std::unique_ptr<WorldPacket> packet(new WorldPacket(m_next.opcode, m_next.size));
+	if (m_next.size)
+		packet->append(&m_nextPayload[0], m_next.size);
+
+	session->QueuePacket(std::move(packet));
+	++m_packets;
+}
+
+void PacketReplay::Update(uint32 diff)
+{
+	if (!m_file)
+		return;
+
+	if (!m_tick)
+		m_startMSTime = WorldTimer::getMSTime();
+	else
+		m_time += uint64(diff) * 1000;
+
+	while (m_hasNext && (m_timing == REPLAY_TIMING_TICK ? m_next.tick - m_firstTick <= m_tick : m_next.time - m_firstTime <= m_time))
+	{
+		QueueNext();
+		m_hasNext = ReadNext();
+	}
+	++m_tick;
+
+	if (m_hasNext)
+		return;
+
+	sLog.outString("PacketReplay: %s finished, " UI64FMTD " packets in %u ticks, %u ms",
+		m_fileName.c_str(), m_packets, m_tick, WorldTimer::getMSTimeDiff(m_startMSTime, WorldTimer::getMSTime()));
+
+	// the replayed sessions log out like disconnected clients
+	for (auto itr = m_sessions.begin(); itr != m_sessions.end(); ++itr)
+		if (WorldSession* session = sSessionTable.Resolve(itr->second))
+			session->KickPlayer();
+
+	Stop();
+}
@@ -0,0 +1,138 @@
+#ifndef _PACKETCAPTURE_H
+#define _PACKETCAPTURE_H
+
+#include <Common.h>
+#include <Config/Singleton.h>
+#include "SessionTable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class WorldPacket;
+
+#define PACKET_CAPTURE_MAGIC        0x4B50524F          // "ORPK"
+#define PACKET_CAPTURE_VERSION      1
+// records arriving while this much is waiting for the world thread to write it are dropped
+#define PACKET_CAPTURE_MAX_PENDING  (64 * 1024 * 1024)
+
+#if defined( __GNUC__ )
+#pragma pack(1)
+#else
+#pragma pack(push,1)
+#endif
+/// Start of a capture file, all fields little endian
+struct PacketCaptureHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint64 startTime;                                       // unix time the capture started
+};
+
+/// One inbound frame, followed by size bytes of payload
+struct PacketCaptureRecord
+{
+	uint64 time;                                            // microseconds since the capture started
+	uint64 session;                                         // raw SessionHandle, one value per login
+	uint32 tick;                                            // world ticks since the capture started
+	uint32 accountId;
+	uint16 opcode;
+	uint16 size;
+};
+#if defined( __GNUC__ )
+#pragma pack()
+#else
+#pragma pack(pop)
+#endif
+
+/// Binary capture of the packets network threads route to sessions.
+/// Network threads only append to a memory buffer, the world thread writes it out once per tick.
+class PacketCapture
+{
+public:
+	PacketCapture() : m_capturing(false), m_file(nullptr), m_startTick(0), m_records(0), m_dropped(0) {}
+	~PacketCapture() { Stop(); }
+
+	/// Open the file and start capturing, false if it cannot be created or a capture is running
+	bool Start(std::string const& fileName);
+	void Stop();
+
+	bool IsCapturing() const { return m_capturing.load(std::memory_order_acquire); }
+
+	/// Called by the network threads for every packet queued to a session
+	void Capture(uint64 session, uint32 accountId, WorldPacket const& packet);
+
+	/// Write the buffered records, world thread only
+	void Flush();
+
+	uint64 GetRecordCount() const { return m_records; }
+	uint64 GetDroppedCount() const { return m_dropped; }
+
+private:
+	std::atomic<bool> m_capturing;
+	FILE* m_file;
+	std::chrono::steady_clock::time_point m_startTime;
+	uint32 m_startTick;
+
+	std::mutex m_bufferLock;
+	std::vector<char> m_buffer;                             // filled by the network threads
+	std::vector<char> m_writeBuffer;                        // swapped in by Flush, written without the lock
+
+	std::atomic<uint64> m_records;
+	std::atomic<uint64> m_dropped;
+};
+
+/// Feeds a capture back into WorldSession::QueuePacket.
+/// Every captured session gets a socketless WorldSession, its packets are queued at the world tick
+/// (or time) they were received, so the same capture always produces the same tick by tick load.
+class PacketReplay
+{
+public:
+	enum Timing
+	{
+		REPLAY_TIMING_TICK = 0,                             // same world tick offset as captured, deterministic
+		REPLAY_TIMING_TIME = 1,                             // same wall time offset as captured
+	};
+
+	PacketReplay() : m_file(nullptr), m_timing(REPLAY_TIMING_TICK), m_hasNext(false), m_tick(0), m_firstTick(0), m_time(0), m_firstTime(0), m_startMSTime(0), m_packets(0) {}
+	~PacketReplay() { Stop(); }
+
+	/// Open a capture file, false if it cannot be read or has the wrong format
+	bool Start(std::string const& fileName, Timing timing);
+	void Stop();
+
+	bool IsReplaying() const { return m_file != nullptr; }
+
+	/// Queue the packets due this tick, called by World::Update before the sessions are updated
+	void Update(uint32 diff);
+
+private:
+	bool ReadNext();
+	void QueueNext();
+
+	FILE* m_file;
+	std::string m_fileName;
+	Timing m_timing;
+
+	PacketCaptureRecord m_next;
+	std::vector<uint8> m_nextPayload;
+	bool m_hasNext;
+
+	uint32 m_tick;
+	uint32 m_firstTick;                                     // capture tick of the first record, replayed on the first tick
+	uint64 m_time;                                          // microseconds since the replay started
+	uint64 m_firstTime;                                     // capture time of the first record, replayed at once
+	uint32 m_startMSTime;
+	uint64 m_packets;
+
+	/// captured session -> replayed session
+	std::unordered_map<uint64, SessionHandle> m_sessions;
+};
+
+#define sPacketCapture Origin::Singleton<PacketCapture>::Instance()
+#define sPacketReplay Origin::Singleton<PacketReplay>::Instance()
+#endif
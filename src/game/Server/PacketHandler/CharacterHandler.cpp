@@ -57,42 +57,23 @@ bool LoginQueryHolder::Initialize()
 	*/
 	return res;
 }
-class CharacterHandler
-{
-public:
-	void HandleCharEnumCallback(QueryResult* result, uint32 account)
-	{
-		WorldSession* session = sWorld.FindSession(account);
-		if (!session)
-		{
-			delete result;
-			return;
-		}
-		session->HandleCharEnum(result);
-	}
-	void HandlePlayerLoginCallback(QueryResult* /*dummy*/, SqlQueryHolder* holder)
-	{
-		if (!holder) return;
-		WorldSession* session = sWorld.FindSession(((LoginQueryHolder*)holder)->GetAccountId());
-		if (!session)
-		{
-			delete holder;
-			return;
-		}
-		session->HandlePlayerLogin((LoginQueryHolder*)holder);
-	}
-} chrHandler;
 
 void WorldSession::HandleCharEnumOpcode(WorldPacket& /*recv_data*/)
+{
+	LoadCharEnum();
+}
+SessionTask WorldSession::LoadCharEnum()
 {
 	/// get all the data necessary for loading all characters (along with their pets) on the account
-	CharacterDatabase.AsyncPQuery(&chrHandler, &CharacterHandler::HandleCharEnumCallback, GetAccountId(),
+	QueryResult* result = co_await CharacterDatabase.AwaitPQuery(
 		//           0               1                2                3                 4                  5                       6                        7
 		"SELECT characters.guid, characters.name, characters.class, characters.gender, characters.money, characters.playerBytes, characters.playerBytes2, characters.level, "
 		//   8             9               10                     11                     12                     13                    14
 		"characters.zone, characters.map, characters.position_x, characters.position_y, characters.position_z, characters.guildid, characters.playerFlags "
 		"FROM characters WHERE characters.account = '%u' ORDER BY characters.guid",
 		GetAccountId());
+
+	HandleCharEnum(result);
 }
 void WorldSession::HandleCharEnum(QueryResult* result)
 {
@@ -149,8 +130,14 @@ void WorldSession::HandleCharEnum(QueryResult* result)
 void WorldSession::HandlePlayerLoginOpcode(WorldPacket& recv_data) /* PLAYER LOGIN TO GO IN GAME */
 {
 	uint32 id;
-	
-	recv_data >> id;
+
+	PacketReader reader(recv_data);
+	reader >> id;
+	if (!reader)
+	{
+		HandleMalformedPacket(recv_data);
+		return;
+	}
 	ObjectGuid playerGuid(HIGHGUID_PLAYER, uint32(id));// character guid from database i guess
 
 	sLog.outError("High = %d, Entry = %d, counter = %d", playerGuid.GetHigh(), playerGuid.GetEntry(), playerGuid.GetCounter());
@@ -160,15 +147,19 @@ void WorldSession::HandlePlayerLoginOpcode(WorldPacket& recv_data) /* PLAYER LOG
 		return;
 	}
 
+	LoginPlayer(playerGuid);
+}
+SessionTask WorldSession::LoginPlayer(ObjectGuid playerGuid)
+{
 	m_playerLoading = true;
-	LoginQueryHolder* holder = new LoginQueryHolder(GetAccountId(), playerGuid);
-	if (!holder->Initialize())
+	std::unique_ptr<LoginQueryHolder> holder(new LoginQueryHolder(GetAccountId(), playerGuid));
+	if (!holder->Initialize() || !co_await CharacterDatabase.AwaitQueryHolder(holder.get()))
 	{
-		delete holder;                                      // delete all unprocessed queries
-		m_playerLoading = false;
-		return;
+		m_playerLoading = false;                            // holder deletes all unprocessed queries
+		co_return;
 	}
-	CharacterDatabase.DelayQueryHolder(&chrHandler, &CharacterHandler::HandlePlayerLoginCallback, holder);
+
+	HandlePlayerLogin(holder.get());
 }
 void WorldSession::HandlePlayerLogin(LoginQueryHolder* holder)
 {
@@ -179,7 +170,6 @@ void WorldSession::HandlePlayerLogin(LoginQueryHolder* holder)
 	{
 		KickPlayer();                                       // disconnect client, player no set to session and it will not deleted or saved at kick
 		delete pCurrChar;                                   // delete it manually
-		delete holder;                                      // delete all unprocessed queries
 		m_playerLoading = false;
 		return;
 	}
@@ -219,7 +209,13 @@ void WorldSession::HandleCharDeleteOpcode(WorldPacket& recv_data)
 	uint32 accountId = 0;
 	std::string name;
 
-	recv_data >> uid;
+	PacketReader reader(recv_data);
+	reader >> uid;
+	if (!reader)
+	{
+		HandleMalformedPacket(recv_data);
+		return;
+	}
 
 	QueryResult* result = CharacterDatabase.PQuery("SELECT account,name FROM characters WHERE guid='%u'", uid);
 	if (result)
@@ -282,17 +278,16 @@ void WorldSession::HandleCharCreateOpcode(WorldPacket& recv_data)
 	// extract other data required for player creating
 	uint8 gender, hair, hairColor, jaw, skin, nose, eyes;
 
-	recv_data >> name;
-
-	recv_data >> class_;
+	PacketReader reader(recv_data);
+	reader >> name;
+	reader >> class_;
+	reader >> gender >> skin >> hair >> hairColor >> jaw >> nose >> eyes;
+	if (!reader)
+	{
+		HandleMalformedPacket(recv_data);
+		return;
+	}
 
-	recv_data >> gender;
-	recv_data >> skin;
-	recv_data >> hair;
-	recv_data >> hairColor;
-	recv_data >> jaw;
-	recv_data >> nose;
-	recv_data >> eyes;
 	WorldPacket data(SMSG_CHAR_CREATE, 1);                  // returned with diff.values in all cases
 
 															// prevent character creating with invalid name
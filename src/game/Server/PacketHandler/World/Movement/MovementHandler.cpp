@@ -16,10 +16,14 @@ void WorldSession::HandleMoveOpcodes(WorldPacket& packet)
 	uint16 opcode = packet.GetOpcode();
 	float x, y, z, o;
 
-	packet >> x;
-	packet >> y;
-	packet >> z;
-	packet >> o;
+	// movement is the bulk of the inbound traffic, parse it without exceptions
+	PacketReader reader(packet);
+	reader >> x >> y >> z >> o;
+	if (!reader)
+	{
+		HandleMalformedPacket(packet);
+		return;
+	}
 
 	WorldPacket data(opcode, 4 + 4 + 4 + 4 + 4);
 	data << _player->GetGUIDLow();
@@ -28,18 +32,22 @@ void WorldSession::HandleMoveOpcodes(WorldPacket& packet)
 	data << z;
 	data << o;
 
-	_player->SendToOther(data, false);
+	_player->SendMovementToOther(data);
 	_player->Relocate(x, y, z, o);
 }
 void WorldSession::HandleMoveRelocate(WorldPacket& packet)
 {
 	uint16 opcode = packet.GetOpcode();
 	float x, y, z, o;
-	packet >> x;
-	packet >> y;
-	packet >> z;
-	packet >> o;
-	
+
+	PacketReader reader(packet);
+	reader >> x >> y >> z >> o;
+	if (!reader)
+	{
+		HandleMalformedPacket(packet);
+		return;
+	}
+
 	WorldPacket data(opcode, 4 + 4 + 4 + 4 + 4);
 	data << _player->GetGUIDLow();
 	data << x;
@@ -47,7 +55,7 @@ void WorldSession::HandleMoveRelocate(WorldPacket& packet)
 	data << z;
 	data << o;
 
-	_player->SendToOther(data, false);
+	_player->SendMovementToOther(data);
 	_player->Relocate(x, y, z, o);
 }
 void WorldSession::HandleMovementOpcodes(WorldPacket& recvPacket)
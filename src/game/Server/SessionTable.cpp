@@ -0,0 +1,76 @@
+#include "SessionTable.h"
+#include "WorldSession.h"
+#include "WorldPacket.h"
+
+INSTANTIATE_SINGLETON_1(SessionTable);
+
+SessionHandle SessionTable::Register(WorldSession* session)
+{
+	uint32 shardIndex = m_nextShard.fetch_add(1, std::memory_order_relaxed) % SESSION_TABLE_SHARDS;
+	Shard& shard = m_shards[shardIndex];
+	std::lock_guard<std::mutex> guard(shard.lock);
+
+	uint32 index;
+	if (!shard.freeSlots.empty())
+	{
+		index = shard.freeSlots.back();
+		shard.freeSlots.pop_back();
+	}
+	else
+	{
+		index = shard.slots.size();
+		shard.slots.push_back(Slot());
+	}
+
+	shard.slots[index].session = session;
+	return SessionHandle(index * SESSION_TABLE_SHARDS + shardIndex, shard.slots[index].generation);
+}
+
+void SessionTable::Unregister(SessionHandle handle)
+{
+	Shard& shard = GetShard(handle);
+	std::lock_guard<std::mutex> guard(shard.lock);
+
+	if (!_Resolve(shard, handle))
+		return;
+
+	uint32 index = handle.GetSlot() / SESSION_TABLE_SHARDS;
+	Slot& slot = shard.slots[index];
+	slot.session = nullptr;
+
+	// skip 0 on wrap around, it marks an empty handle
+	if (!++slot.generation)
+		slot.generation = 1;
+
+	shard.freeSlots.push_back(index);
+}
+
+WorldSession* SessionTable::Resolve(SessionHandle handle) const
+{
+	Shard& shard = GetShard(handle);
+	std::lock_guard<std::mutex> guard(shard.lock);
+	return _Resolve(shard, handle);
+}
+
+bool SessionTable::QueuePacket(SessionHandle handle, std::unique_ptr<WorldPacket> packet)
+{
+	Shard& shard = GetShard(handle);
+	std::lock_guard<std::mutex> guard(shard.lock);
+
+	WorldSession* session = _Resolve(shard, handle);
+	if (!session)
+		return false;
+
+	session->QueuePacket(std::move(packet));
+	return true;
+}
+
+WorldSession* SessionTable::_Resolve(Shard const& shard, SessionHandle handle)
+{
+	uint32 index = handle.GetSlot() / SESSION_TABLE_SHARDS;
+	if (handle.IsEmpty() || index >= shard.slots.size())
+		return nullptr;
+
+	Slot const& slot = shard.slots[index];
+	return slot.generation == handle.GetGeneration() ? slot.session : nullptr;
+}
@@ -0,0 +1,96 @@
+#ifndef _SESSIONTABLE_H
+#define _SESSIONTABLE_H
+
+#include <Common.h>
+#include <Config/Singleton.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+
+// independent parts of the table, slot index % SESSION_TABLE_SHARDS, so network threads rarely share a lock
+#define SESSION_TABLE_SHARDS 16
+
+class WorldSession;
+class WorldPacket;
+
+/// Reference to a WorldSession which can be kept by sockets and database callbacks.
+/// It goes stale as soon as the session is deleted, instead of dangling like a raw pointer.
+class SessionHandle
+{
+public:
+	SessionHandle() : m_raw(0) {}
+	SessionHandle(uint32 slot, uint32 generation) : m_raw(MAKE_PAIR64(slot, generation)) {}
+	explicit SessionHandle(uint64 raw) : m_raw(raw) {}
+
+	uint32 GetSlot() const { return PAIR64_LOPART(m_raw); }
+	uint32 GetGeneration() const { return PAIR64_HIPART(m_raw); }
+	uint64 GetRawValue() const { return m_raw; }
+
+	/// generation 0 is never handed out
+	bool IsEmpty() const { return GetGeneration() == 0; }
+
+	bool operator==(SessionHandle const& other) const { return m_raw == other.m_raw; }
+	bool operator!=(SessionHandle const& other) const { return m_raw != other.m_raw; }
+
+private:
+	uint64 m_raw;
+};
+
+/// Slot table of all live sessions, a slot is reused with a new generation after its session is deleted.
+/// Sessions are spread over shards with a lock each, which keeps a session alive while it is used.
+class SessionTable
+{
+public:
+	SessionTable() : m_nextShard(0) {}
+
+	SessionHandle Register(WorldSession* session);
+	void Unregister(SessionHandle handle);
+
+	/// O(1) lookup, nullptr if the session behind the handle is gone
+	WorldSession* Resolve(SessionHandle handle) const;
+
+	/// Route a received packet to the session, the shard lock keeps it alive during the call
+	bool QueuePacket(SessionHandle handle, std::unique_ptr<WorldPacket> packet);
+
+	/// Run worker on the session while it cannot be deleted, for use from network threads
+	template<typename Worker>
+	bool Execute(SessionHandle handle, Worker const& worker)
+	{
+		Shard& shard = GetShard(handle);
+		std::lock_guard<std::mutex> guard(shard.lock);
+		WorldSession* session = _Resolve(shard, handle);
+		if (!session)
+			return false;
+
+		worker(session);
+		return true;
+	}
+
+private:
+	struct Slot
+	{
+		Slot() : session(nullptr), generation(1) {}
+
+		WorldSession* session;
+		uint32 generation;
+	};
+
+	struct Shard
+	{
+		std::mutex lock;
+		std::vector<Slot> slots;                        // slot index / SESSION_TABLE_SHARDS
+		std::vector<uint32> freeSlots;
+	};
+
+	Shard& GetShard(SessionHandle handle) const { return m_shards[handle.GetSlot() % SESSION_TABLE_SHARDS]; }
+	/// Under the lock of shard
+	static WorldSession* _Resolve(Shard const& shard, SessionHandle handle);
+
+	mutable Shard m_shards[SESSION_TABLE_SHARDS];
+	std::atomic<uint32> m_nextShard;                    // new sessions go round robin over the shards
+};
+
+#define sSessionTable Origin::Singleton<SessionTable>::Instance()
+#endif
@@ -0,0 +1,52 @@
+#ifndef _SESSIONTASK_H
+#define _SESSIONTASK_H
+
+#include <Common.h>
+#include <Log.h>
+#include "SessionTable.h"
+
+#include <coroutine>
+#include <exception>
+
+/// Return type of WorldSession member coroutines, e.g. handlers waiting on Database::AwaitPQuery.
+/// Fire and forget: it runs until the first co_await and frees its frame when it finishes.
+/// After each co_await it only continues while its session is alive, otherwise the frame is destroyed
+/// (and with it the locals and any result not taken yet). Parameters are copied into the frame,
+/// so never pass references to packets or other short lived data.
+class SessionTask
+{
+public:
+	struct promise_type
+	{
+		// the implicit object parameter of the WorldSession member comes first
+		template<class Session, typename... Args>
+		promise_type(Session& session, Args&&...) : m_session(session.GetHandle()) {}
+
+		SessionTask get_return_object() { return SessionTask(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+
+		void unhandled_exception()
+		{
+			try
+			{
+				throw;
+			}
+			catch (std::exception& e)
+			{
+				sLog.outError("SessionTask: unhandled exception '%s'", e.what());
+			}
+			catch (...)
+			{
+				sLog.outError("SessionTask: unhandled exception");
+			}
+		}
+
+		/// checked by SqlResumption before continuing
+		bool CanResume() const { return sSessionTable.Resolve(m_session) != nullptr; }
+
+		SessionHandle const m_session;
+	};
+};
+#endif
@@ -2,6 +2,8 @@
 #include "Common.h"
 #include "Database/DatabaseEnv.h"
 #include "Log.h"
+#include "Watchdog.h"
+#include "GameClock.h"
 #include "Opcodes.h"
 #include "WorldPacket.h"
 #include "WorldSession.h"
@@ -9,10 +11,13 @@
 #include "../World/World.h"
 #include "ObjectAccessor.h"
 
+#include <chrono>
 #include <mutex>
 #include <deque>
 #include <memory>
 
+OpcodeStats WorldSession::s_opcodeStats[NUM_MSG_TYPES];
+
 // select opcodes appropriate for processing in Map::Update context for current session state
 static bool MapSessionFilterHelper(WorldSession* session, OpcodeHandler const& opHandle)
 {
@@ -56,33 +61,62 @@ bool WorldSessionFilter::Process(WorldPacket* packet)
 /// WorldSession constructor
 WorldSession::WorldSession(uint32 id, WorldSocket* sock, AccountTypes sec, time_t mute_time, LocaleConstant locale) :
 	m_muteTime(mute_time),
-	_player(nullptr), m_Socket(sock), _security(sec), _accountId(id), _logoutTime(0),
-	m_inQueue(false), m_playerLoading(false), m_playerLogout(false), m_playerRecentlyLogout(false), m_playerSave(false),
-	m_latency(0), m_clientTimeDelay(0), m_tutorialState(TUTORIALDATA_UNCHANGED) {}
+	_player(nullptr), m_Socket(sock), m_socketlessClosed(false), _security(sec), _accountId(id), _logoutTime(0),
+	m_inQueue(false), m_queueTicket(0), m_queuePos(0), m_playerLoading(false), m_playerLogout(false), m_playerRecentlyLogout(false), m_playerSave(false),
+	m_latency(0), m_clientTimeDelay(0), m_packetBudgetOverruns(0),
+	m_packetBudgetLogTime(0), m_packetBudgetLoggedOverruns(0), m_tutorialState(TUTORIALDATA_UNCHANGED)
+{
+	m_handle = sSessionTable.Register(this);
+}
 
 /// WorldSession destructor
 WorldSession::~WorldSession()
 {
+	///- stop sockets and pending callbacks from reaching this session
+	sSessionTable.Unregister(m_handle);
+
 	///- unload player if not unloaded
 	if (_player)
 		LogoutPlayer(true);
-	m_Socket->ClearSession();
+	if (m_Socket)
+		m_Socket->ClearSession();
 }
 /// Get the player name
 char const* WorldSession::GetPlayerName() const
 {
 	return GetPlayer() ? GetPlayer()->GetName() : "<none>";
 }
+/// Address of the client, sessions fed by PacketReplay have none
+const std::string& WorldSession::GetRemoteAddress() const
+{
+	static const std::string replayAddress("<replay>");
+	return m_Socket ? m_Socket->GetRemoteAddress() : replayAddress;
+}
+bool WorldSession::IsConnectionClosed() const
+{
+	return m_Socket ? m_Socket->IsClosed() : m_socketlessClosed;
+}
 void WorldSession::SizeError(WorldPacket const& packet, uint32 size) const
 {
 	sLog.outError("Client (account %u) send packet %s (%u) with size " SIZEFMTD " but expected %u (attempt crash server?), skipped",
 		GetAccountId(), packet.GetOpcodeName(), packet.GetOpcode(), packet.size(), size);
 }
 
+void WorldSession::HandleMalformedPacket(WorldPacket const& packet)
+{
+	sWorld.AddMalformedPacket();
+	DEBUG_LOG("SESSION: account %u sent malformed %s (0x%.4X), size " SIZEFMTD,
+		GetAccountId(), packet.GetOpcodeName(), packet.GetOpcode(), packet.size());
+
+	if (sWorld.getConfig(CONFIG_BOOL_KICK_PLAYER_ON_BAD_PACKET))
+		KickPlayer();
+}
+
 /// Send a packet to the client
 void WorldSession::SendPacket(WorldPacket const* packet, bool immediate)
 {
-	if (m_Socket->IsClosed())
+	// replayed sessions have nobody to send to
+	if (!m_Socket || m_Socket->IsClosed())
 		return;
 
 #ifdef ORIGIN_DEBUG
@@ -97,7 +131,7 @@ void WorldSession::SendPacket(WorldPacket const* packet, bool immediate)
 	static uint64 sendLastPacketCount = 0;
 	static uint64 sendLastPacketBytes = 0;
 
-	time_t cur_time = time(nullptr);
+	time_t cur_time = GameClock::GetGameTime();
 
 	if ((cur_time - lastTime) < 60)
 	{
@@ -126,8 +160,11 @@ void WorldSession::SendPacket(WorldPacket const* packet, bool immediate)
 /// Add an incoming packet to the queue
 void WorldSession::QueuePacket(std::unique_ptr<WorldPacket> new_packet)
 {
-	std::lock_guard<std::mutex> guard(m_recvQueueLock);
-	m_recvQueue.push_back(std::move(new_packet));
+	// route by opcode here, so Map::Update and World::UpdateSessions each only look at packets they may handle
+	RecvQueueType queue = opcodeTable[new_packet->GetOpcode()].packetProcessing == PROCESS_THREADSAFE ? RECV_QUEUE_MAP : RECV_QUEUE_WORLD;
+
+	std::lock_guard<std::mutex> guard(m_recvQueueLock[queue]);
+	m_recvQueue[queue].push_back(std::move(new_packet));
 }
 
 /// Logging helper for unexpected opcodes
@@ -151,120 +188,192 @@ void WorldSession::LogUnprocessedTail(WorldPacket const& packet)
 /// Update the WorldSession (triggered by World update)
 bool WorldSession::Update(PacketFilter& updater)
 {
-	std::lock_guard<std::mutex> guard(m_recvQueueLock);
+	///- Per tick budget, a flooding client keeps the rest of its packets for the next tick instead of starving other sessions.
+	/// The map and the world update the session in the same tick, both spend the same budget.
+	if (m_packetBudget.tick != sWorld.GetUpdateTick())
+	{
+		m_packetBudget = PacketBudget();
+		m_packetBudget.tick = sWorld.GetUpdateTick();
+	}
+
+	///- Each context drains its own queue, the world also takes thread-safe packets the map cannot process (player not in world)
+	if (updater.ProcessesQueue(RECV_QUEUE_WORLD))
+		ProcessQueue(RECV_QUEUE_WORLD, updater);
+	ProcessQueue(RECV_QUEUE_MAP, updater);
+
+	// check if we are safe to proceed with logout
+	// logout procedure should happen only in World::UpdateSessions() method!!!
+	if (updater.ProcessLogout())
+	{
+		///- If necessary, log the player out
+		const time_t currTime = GameClock::GetGameTime();
+
+		if (IsConnectionClosed() || (ShouldLogOut(currTime) && !m_playerLoading))
+			LogoutPlayer(true);
+
+		// finalize the session if disconnected.
+		if (IsConnectionClosed())
+			return false;
+	}
+
+	return true;
+}
+
+/// Handle packets of one receive queue while the filter accepts them and the budget lasts
+void WorldSession::ProcessQueue(RecvQueueType queue, PacketFilter& updater)
+{
+	PacketBudget& budget = m_packetBudget;
+	uint32 maxPackets = sWorld.getConfig(CONFIG_UINT32_PACKET_BUDGET_COUNT);
+	uint32 maxTime = sWorld.getConfig(CONFIG_UINT32_PACKET_BUDGET_TIME);
+	uint32 startTime = WorldTimer::getMSTime();
+	uint32 usedBefore = budget.usedTime;
+
+	std::lock_guard<std::mutex> guard(m_recvQueueLock[queue]);
+	PacketQueue& packets = m_recvQueue[queue];
+
 	///- Retrieve packets from the receive queue and call the appropriate handlers
 	/// not process packets if socket already closed
-	while (m_Socket && !m_Socket->IsClosed() && !m_recvQueue.empty())
+	while (!IsConnectionClosed() && !packets.empty())
 	{
-		auto const packet = std::move(m_recvQueue.front());
-		m_recvQueue.pop_front();
-
-		/*#if 1
-		sLog.outError( "MOEP: %s (0x%.4X)",
-		packet->GetOpcodeName(),
-		packet->GetOpcode());
-		#endif*/
-		OpcodeHandler const& opHandle = opcodeTable[packet->GetOpcode()];
-		try
+		// the rest waits for the other context, e.g. the player left the map while handling a packet
+		if (!updater.Process(packets.front().get()))
+			break;
+
+		budget.usedTime = usedBefore + WorldTimer::getMSTimeDiff(startTime, WorldTimer::getMSTime());
+		if ((maxPackets && budget.processed >= maxPackets) || (maxTime && budget.usedTime >= maxTime))
 		{
-			switch (opHandle.status)
+			// once per tick, the other pass of the tick finds the budget spent as well
+			if (!budget.overrun)
 			{
-			case STATUS_LOGGEDIN:
-				if (!_player)
-				{
-					// skip STATUS_LOGGEDIN opcode unexpected errors if player logout sometime ago - this can be network lag delayed packets
-					if (!m_playerRecentlyLogout)
-						LogUnexpectedOpcode(*packet, "the player has not logged in yet");
-				}
-				else if (_player->IsInWorld())
-					ExecuteOpcode(opHandle, *packet);
+				budget.overrun = true;
+				++m_packetBudgetOverruns;
+				sWorld.AddPacketBudgetOverrun(packets.size());
 
-				// lag can cause STATUS_LOGGEDIN opcodes to arrive after the player started a transfer
-				break;
-			case STATUS_LOGGEDIN_OR_RECENTLY_LOGGEDOUT:
-				if (!_player && !m_playerRecentlyLogout)
-				{
-					LogUnexpectedOpcode(*packet, "the player has not logged in yet and not recently logout");
-				}
-				else
-					// not expected _player or must checked in packet hanlder
-					ExecuteOpcode(opHandle, *packet);
-				break;
-			case STATUS_TRANSFER:
-				if (!_player)
-					LogUnexpectedOpcode(*packet, "the player has not logged in yet");
-				else if (_player->IsInWorld())
-					LogUnexpectedOpcode(*packet, "the player is still in world");
-				else
-					ExecuteOpcode(opHandle, *packet);
-				break;
-			case STATUS_AUTHED:
-				// prevent cheating with skip queue wait
-				if (m_inQueue)
+				uint32 now = GameClock::GetMSTime();
+				if (!m_packetBudgetLogTime || WorldTimer::getMSTimeDiff(m_packetBudgetLogTime, now) >= PACKET_BUDGET_LOG_INTERVAL)
 				{
-					LogUnexpectedOpcode(*packet, "the player not pass queue yet");
-					break;
+					DETAIL_LOG("SESSION: account %u hit the packet budget %u times since the last report, " SIZEFMTD " packets deferred this tick",
+						GetAccountId(), m_packetBudgetOverruns - m_packetBudgetLoggedOverruns, packets.size());
+					m_packetBudgetLogTime = now;
+					m_packetBudgetLoggedOverruns = m_packetBudgetOverruns;
 				}
-
-				// single from authed time opcodes send in to after logout time
-				// and before other STATUS_LOGGEDIN_OR_RECENTLY_LOGGOUT opcodes.
-				m_playerRecentlyLogout = false;
-
-				ExecuteOpcode(opHandle, *packet);
-				break;
-			case STATUS_NEVER:
-				sLog.outError("SESSION: received not allowed opcode %s (0x%.4X)",
-					packet->GetOpcodeName(),
-					packet->GetOpcode());
-				break;
-			case STATUS_UNHANDLED:
-				DEBUG_LOG("SESSION: received not handled opcode %s (0x%.4X)",
-					packet->GetOpcodeName(),
-					packet->GetOpcode());
-				break;
-			default:
-				sLog.outError("SESSION: received wrong-status-req opcode %s (0x%.4X)",
-					packet->GetOpcodeName(),
-					packet->GetOpcode());
-				break;
 			}
+			break;
 		}
-		catch (ByteBufferException&)
+		++budget.processed;
+
+		auto const packet = std::move(packets.front());
+		packets.pop_front();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ProcessPacket(*packet);
+		uint32 handlerTime = uint32(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+		OpcodeStats& stats = s_opcodeStats[packet->GetOpcode()];
+		stats.count.fetch_add(1, std::memory_order_relaxed);
+		stats.totalTime.fetch_add(handlerTime, std::memory_order_relaxed);
+		uint32 opcodeMax = stats.maxTime.load(std::memory_order_relaxed);
+		while (handlerTime > opcodeMax && !stats.maxTime.compare_exchange_weak(opcodeMax, handlerTime, std::memory_order_relaxed)) {}
+	}
+}
+
+void WorldSession::ResetOpcodeStats()
+{
+	for (uint32 i = 0; i < NUM_MSG_TYPES; ++i)
+	{
+		s_opcodeStats[i].count = 0;
+		s_opcodeStats[i].totalTime = 0;
+		s_opcodeStats[i].maxTime = 0;
+	}
+}
+
+/// Check the session state and call the opcode handler
+void WorldSession::ProcessPacket(WorldPacket& packet)
+{
+	OpcodeHandler const& opHandle = opcodeTable[packet.GetOpcode()];
+	try
+	{
+		switch (opHandle.status)
 		{
-			sLog.outError("WorldSession::Update ByteBufferException occured while parsing a packet (opcode: %u) from client %s, accountid=%i.",
-				packet->GetOpcode(), GetRemoteAddress().c_str(), GetAccountId());
-			if (sLog.HasLogLevelOrHigher(LOG_LVL_DEBUG))
+		case STATUS_LOGGEDIN:
+			if (!_player)
 			{
-				DEBUG_LOG("Dumping error causing packet:");
-				packet->hexlike();
+				// skip STATUS_LOGGEDIN opcode unexpected errors if player logout sometime ago - this can be network lag delayed packets
+				if (!m_playerRecentlyLogout)
+					LogUnexpectedOpcode(packet, "the player has not logged in yet");
 			}
+			else if (_player->IsInWorld())
+				ExecuteOpcode(opHandle, packet);
 
-			if (sWorld.getConfig(CONFIG_BOOL_KICK_PLAYER_ON_BAD_PACKET))
+			// lag can cause STATUS_LOGGEDIN opcodes to arrive after the player started a transfer
+			break;
+		case STATUS_LOGGEDIN_OR_RECENTLY_LOGGEDOUT:
+			if (!_player && !m_playerRecentlyLogout)
 			{
-				DETAIL_LOG("Disconnecting session [account id %u / address %s] for badly formatted packet.",
-					GetAccountId(), GetRemoteAddress().c_str());
-
-				KickPlayer();
+				LogUnexpectedOpcode(packet, "the player has not logged in yet and not recently logout");
 			}
+			else
+				// not expected _player or must checked in packet hanlder
+				ExecuteOpcode(opHandle, packet);
+			break;
+		case STATUS_TRANSFER:
+			if (!_player)
+				LogUnexpectedOpcode(packet, "the player has not logged in yet");
+			else if (_player->IsInWorld())
+				LogUnexpectedOpcode(packet, "the player is still in world");
+			else
+				ExecuteOpcode(opHandle, packet);
+			break;
+		case STATUS_AUTHED:
+			// prevent cheating with skip queue wait
+			if (m_inQueue)
+			{
+				LogUnexpectedOpcode(packet, "the player not pass queue yet");
+				break;
+			}
+
+			// single from authed time opcodes send in to after logout time
+			// and before other STATUS_LOGGEDIN_OR_RECENTLY_LOGGOUT opcodes.
+			m_playerRecentlyLogout = false;
+
+			ExecuteOpcode(opHandle, packet);
+			break;
+		case STATUS_NEVER:
+			sLog.outError("SESSION: received not allowed opcode %s (0x%.4X)",
+				packet.GetOpcodeName(),
+				packet.GetOpcode());
+			break;
+		case STATUS_UNHANDLED:
+			DEBUG_LOG("SESSION: received not handled opcode %s (0x%.4X)",
+				packet.GetOpcodeName(),
+				packet.GetOpcode());
+			break;
+		default:
+			sLog.outError("SESSION: received wrong-status-req opcode %s (0x%.4X)",
+				packet.GetOpcodeName(),
+				packet.GetOpcode());
+			break;
 		}
 	}
-
-	// check if we are safe to proceed with logout
-	// logout procedure should happen only in World::UpdateSessions() method!!!
-	if (updater.ProcessLogout())
+	catch (ByteBufferException& e)
 	{
-		///- If necessary, log the player out
-		const time_t currTime = time(nullptr);
+		e.PrintPosError();
+		sLog.outError("WorldSession::Update ByteBufferException occured while parsing a packet (opcode: %u) from client %s, accountid=%i.",
+			packet.GetOpcode(), GetRemoteAddress().c_str(), GetAccountId());
+		if (sLog.HasLogLevelOrHigher(LOG_LVL_DEBUG))
+		{
+			DEBUG_LOG("Dumping error causing packet:");
+			packet.hexlike();
+		}
 
-		if (m_Socket->IsClosed() || (ShouldLogOut(currTime) && !m_playerLoading))
-			LogoutPlayer(true);
+		if (sWorld.getConfig(CONFIG_BOOL_KICK_PLAYER_ON_BAD_PACKET))
+		{
+			DETAIL_LOG("Disconnecting session [account id %u / address %s] for badly formatted packet.",
+				GetAccountId(), GetRemoteAddress().c_str());
 
-		// finalize the session if disconnected.
-		if (m_Socket->IsClosed())
-			return false;
+			KickPlayer();
+		}
 	}
-
-	return true;
 }
 
 void WorldSession::Handle_NULL(WorldPacket& recvPacket)
@@ -318,6 +427,7 @@ void WorldSession::ExecuteOpcode(OpcodeHandler const& opHandle, WorldPacket &pac
 	/*if (_player)
 		_player->SetCanDelayTeleport(true);*/
 
+	Origin::WatchdogPhase phase(opHandle.name, WATCHDOG_NO_VALUE, packet.GetOpcode());
 	(this->*opHandle.handler)(packet);
 
 	if (_player)
@@ -354,14 +464,6 @@ void WorldSession::LogoutPlayer(bool save)
 	{
 		sLog.outChar("Account: %d (IP: %s) Logout Character:[%s] (guid: %u)", GetAccountId(), GetRemoteAddress().c_str(), _player->GetName(), _player->GetGUIDLow());
 
-		///- Reset the online field in the account table
-		// no point resetting online in character table here as Player::SaveToDB() will set it to 1 since player has not been removed from world at this stage
-		// No SQL injection as AccountID is uint32
-		static SqlStatementID id;
-
-		SqlStatement stmt = LoginDatabase.CreateStatement(id, "UPDATE account SET active_realm_id = ? WHERE id = ?");
-		stmt.PExecute(uint32(0), GetAccountId());
-
 		// some save parts only correctly work in case player present in map/player_lists (pets, etc)
 		if (save)
 			_player->SaveToDB();
@@ -387,12 +489,9 @@ void WorldSession::LogoutPlayer(bool save)
 		WorldPacket data(SMSG_LOGOUT_COMPLETE, 0);
 		SendPacket(&data);
 
-		///- Since each account can only have one online character at any given time, ensure all characters for active account are marked as offline
-		// No SQL injection as AccountId is uint32
-
-		static SqlStatementID updChars;
-		stmt = CharacterDatabase.CreateStatement(updChars, "UPDATE characters SET online = 0 WHERE account = ?");
-		stmt.PExecute(GetAccountId());
+		///- Reset the online field in the account table and mark all characters of the account offline
+		// both are written in one batch for all logouts by the next World::FlushRealmBookkeeping
+		sWorld.QueueAccountLogout(GetAccountId());
 		DEBUG_LOG("SESSION: Sent SMSG_LOGOUT_COMPLETE Message");
 	}
 
@@ -405,6 +504,8 @@ void WorldSession::LogoutPlayer(bool save)
 /// Kick a player out of the World
 void WorldSession::KickPlayer()
 {
-	if (!m_Socket->IsClosed())
+	if (!m_Socket)
+		m_socketlessClosed = true;
+	else if (!m_Socket->IsClosed())
 		m_Socket->Close();
 }
\ No newline at end of file
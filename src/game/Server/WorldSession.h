@@ -5,7 +5,10 @@
 #include "SharedDefine.h"
 #include "../Object/ObjectGuid.h"
 #include "WorldSocket.h"
+#include "SessionTable.h"
+#include "SessionTask.h"
 
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <memory>
@@ -16,7 +19,6 @@ class Player;
 class WorldPacket;
 class QueryResult;
 class LoginQueryHolder;
-class CharacterHandler;
 class WorldSession;
 
 struct OpcodeHandler;
@@ -47,6 +49,24 @@ enum TutorialDataState
 	TUTORIALDATA_NEW = 2
 };
 
+// receive queues, a packet is routed by the PacketProcessing of its opcode when it arrives
+enum RecvQueueType
+{
+	RECV_QUEUE_WORLD = 0,                                   // PROCESS_THREADUNSAFE and PROCESS_INPLACE, World::UpdateSessions() only
+	RECV_QUEUE_MAP,                                         // PROCESS_THREADSAFE, Map::Update() while the player is in world
+	RECV_QUEUE_COUNT
+};
+
+#define PACKET_BUDGET_LOG_INTERVAL (60 * IN_MILLISECONDS)     // a session that keeps hitting its packet budget is logged at most this often
+
+/// Handled packets and handler time of one opcode over all sessions, times in microseconds
+struct OpcodeStats
+{
+	std::atomic<uint64> count;
+	std::atomic<uint64> totalTime;
+	std::atomic<uint32> maxTime;
+};
+
 // class to deal with packet processing
 // allows to determine if next packet is safe to be processed
 class PacketFilter
@@ -57,6 +77,7 @@ public:
 
 	virtual bool Process(WorldPacket* /*packet*/) { return true; }
 	virtual bool ProcessLogout() const { return true; }
+	virtual bool ProcessesQueue(RecvQueueType /*queue*/) const { return true; }
 
 protected:
 	WorldSession* const m_pSession;
@@ -71,6 +92,8 @@ public:
 	virtual bool Process(WorldPacket* packet) override;
 	// in Map::Update() we do not process player logout!
 	virtual bool ProcessLogout() const override { return false; }
+	// nor anything from the world queue
+	virtual bool ProcessesQueue(RecvQueueType queue) const override { return queue == RECV_QUEUE_MAP; }
 };
 
 // class used to filer only thread-unsafe packets from queue
@@ -87,8 +110,6 @@ public:
 /// Player session in the World
 class WorldSession
 {
-	friend class CharacterHandler;
-
 public:
 	WorldSession(uint32 id, WorldSocket* sock, AccountTypes sec, time_t mute_time, LocaleConstant locale);
 	~WorldSession();
@@ -98,19 +119,34 @@ public:
 	bool PlayerLogoutWithSave() const { return m_playerLogout && m_playerSave; }
 
 	void SizeError(WorldPacket const& packet, uint32 size) const;
+	/// For handlers whose PacketReader failed: counted, logged at debug level only, kicks with Network.KickOnBadPacket
+	void HandleMalformedPacket(WorldPacket const& packet);
 
 	void SendPacket(WorldPacket const* packet, bool immediate = false);
 	void SendQueryTimeResponse();
 
 	AccountTypes GetSecurity() const { return _security; }
 	uint32 GetAccountId() const { return _accountId; }
+	/// Handle to keep instead of this pointer in async callbacks
+	SessionHandle GetHandle() const { return m_handle; }
 	Player* GetPlayer() const { return _player; }
 	char const* GetPlayerName() const;
 	void SetSecurity(AccountTypes security) { _security = security; }
-	const std::string &GetRemoteAddress() const { return m_Socket->GetRemoteAddress(); }
+	const std::string &GetRemoteAddress() const;
 
 	/// Session in auth.queue currently
 	void SetInQueue(bool state) { m_inQueue = state; }
+	bool IsInQueue() const { return m_inQueue; }
+
+	/// Ticket taken when entering the auth.queue, and the last position sent to the client
+	void SetQueueTicket(uint32 ticket) { m_queueTicket = ticket; }
+	uint32 GetQueueTicket() const { return m_queueTicket; }
+	void SetQueuePos(uint32 position) { m_queuePos = position; }
+	uint32 GetQueuePos() const { return m_queuePos; }
+
+	/// Statistics of an opcode below NUM_MSG_TYPES
+	static OpcodeStats const& GetOpcodeStats(uint32 opcode) { return s_opcodeStats[opcode]; }
+	static void ResetOpcodeStats();
 
 	/// Is the user engaged in a log out process?
 	bool isLogingOut() const { return _logoutTime || m_playerLogout; }
@@ -131,6 +167,9 @@ public:
 
 	bool Update(PacketFilter& updater);
 
+	/// Ticks in which the session left packets in its queue because it hit the packet budget
+	uint32 GetPacketBudgetOverruns() const { return m_packetBudgetOverruns; }
+
 	/// Handle the authentication waiting queue (to be completed)
 	void SendAuthWaitQue(uint32 position);
 
@@ -156,6 +195,8 @@ public:
 	void HandleCharDeleteOpcode(WorldPacket& recvPacket);
 	void HandleCharCreateOpcode(WorldPacket& recvPacket);
 	void HandlePlayerLoginOpcode(WorldPacket& recvPacket);
+	SessionTask LoadCharEnum();
+	SessionTask LoginPlayer(ObjectGuid playerGuid);
 	void HandleCharEnum(QueryResult* result);
 	void HandlePlayerLogin(LoginQueryHolder* holder);
 	void HandlePlayerEnterWorldfinished(WorldPacket& recv_data);
@@ -169,6 +210,24 @@ public:
 	void HandleMoveOpcodes(WorldPacket& packet);
 	void HandleMoveRelocate(WorldPacket& packet);
 private:
+	typedef std::deque<std::unique_ptr<WorldPacket>> PacketQueue;
+
+	/// What the session used of its packet budget in one world tick, over all its updates
+	struct PacketBudget
+	{
+		PacketBudget() : tick(0), processed(0), usedTime(0), overrun(false) {}
+
+		uint32 tick;                                    // World::GetUpdateTick
+		uint32 processed;
+		uint32 usedTime;                                // ms spent handling packets
+		bool overrun;
+	};
+
+	/// Socket closed, or kicked for sessions without a socket
+	bool IsConnectionClosed() const;
+
+	void ProcessQueue(RecvQueueType queue, PacketFilter& updater);
+	void ProcessPacket(WorldPacket& packet);
 	void ExecuteOpcode(OpcodeHandler const& opHandle, WorldPacket& packet);
 
 	// logging helper
@@ -177,13 +236,17 @@ private:
 
 	std::mutex m_logoutMutex;                           // this mutex is necessary to avoid two simultaneous logouts due to a valid logout request and socket error
 	Player * _player; 
-	WorldSocket * const m_Socket;                       // socket pointer is owned by the network thread which created 
+	WorldSocket * const m_Socket;                       // socket pointer is owned by the network thread which created, nullptr for replayed sessions
+	bool m_socketlessClosed;                            // KickPlayer of a session without socket
 
 	AccountTypes _security;
 	uint32 _accountId;
+	SessionHandle m_handle;
 
 	time_t _logoutTime;
 	bool m_inQueue;                                     // session wait in auth.queue
+	uint32 m_queueTicket;
+	uint32 m_queuePos;
 	bool m_playerLoading;                               // code processed in LoginPlayer
 
 														// True when the player is in the process of logging out (WorldSession::LogoutPlayer is currently executing)
@@ -192,11 +255,17 @@ private:
 	bool m_playerSave;                                  // code processed in LogoutPlayer with save request
 	uint32 m_latency;
 	uint32 m_clientTimeDelay;
+	uint32 m_packetBudgetOverruns;
+	PacketBudget m_packetBudget;
+	uint32 m_packetBudgetLogTime;                       // overruns are logged at most every PACKET_BUDGET_LOG_INTERVAL
+	uint32 m_packetBudgetLoggedOverruns;
+
+	static OpcodeStats s_opcodeStats[];
 	uint32 m_Tutorials[8];
 	TutorialDataState m_tutorialState;
 
-	std::mutex m_recvQueueLock;
-	std::deque<std::unique_ptr<WorldPacket>> m_recvQueue;
+	std::mutex m_recvQueueLock[RECV_QUEUE_COUNT];
+	PacketQueue m_recvQueue[RECV_QUEUE_COUNT];
 };
 #endif
 /// @}
@@ -9,7 +9,10 @@
 #include <Database/DatabaseEnv.h>
 #include <Auth/Sha1.h>
 #include "WorldSession.h"
+#include "SessionTable.h"
+#include "PacketCapture.h"
 #include <Log.h>
+#include <Watchdog.h>
 
 
 #include <chrono>
@@ -35,10 +38,29 @@ struct ServerPktHeader
 #endif
 
 WorldSocket::WorldSocket(boost::asio::io_service &service, std::function<void(Socket *)> closeHandler)
-	: Socket(service, closeHandler), m_lastPingTime(std::chrono::system_clock::time_point::min()), m_overSpeedPings(0),
-	m_useExistingHeader(false), m_session(nullptr), m_seed(urand())
+	: Socket(service, closeHandler), m_lastPingTime(std::chrono::system_clock::time_point::min()), m_overSpeedPings(0), m_lastPingReadTime(0),
+	m_useExistingHeader(false), m_sessionHandle(0), m_accountId(0), m_seed(urand())
 {}
 
+/// Pongs and movement relays overtake queued bulk data such as the object creation burst of a zone-in.
+/// A relay for a unit whose creation is still queued is dropped by the client, the next one is not.
+Origin::Socket::SendLane WorldSocket::GetSendLane(uint16 opcode, bool immediate)
+{
+	if (immediate)
+		return SendLane::Realtime;
+
+	switch (opcode)
+	{
+		case SMSG_PONG:
+		case MSG_MOVEMENT:
+		case MSG_RECLOCATE:
+		case MSG_MOVE_JUMP:
+			return SendLane::Realtime;
+		default:
+			return SendLane::Bulk;
+	}
+}
+
 void WorldSocket::SendPacket(const WorldPacket& pct, bool immediate)
 {
 	if (IsClosed())
@@ -57,13 +79,10 @@ void WorldSocket::SendPacket(const WorldPacket& pct, bool immediate)
 
 	//m_crypt.EncryptSend(reinterpret_cast<uint8 *>(&header), sizeof(header));
 
-	Write(reinterpret_cast<const char *>(&header), sizeof(header));
-	if (header.cmd != MSG_MOVEMENT)
-		sLog.outDebug("Packet id: '%d' size: '%d' sended", header.cmd, pct.size());
-	if (!!pct.size())
-	{
-		Write(reinterpret_cast<const char *>(pct.contents()), pct.size());
-	}
+	Write(reinterpret_cast<const char *>(&header), sizeof(header), reinterpret_cast<const char *>(pct.contents()), int(pct.size()),
+		GetSendLane(pct.GetOpcode(), immediate));
+	if (pct.GetOpcode() != MSG_MOVEMENT)
+		sLog.outDebug("Packet id: '%d' size: '%d' sended", pct.GetOpcode(), pct.size());
 
 	if (immediate)
 		ForceFlushOut();
@@ -164,12 +183,14 @@ bool WorldSocket::ProcessIncomingData()
 	}
 	if (opcode != MSG_MOVEMENT)
 		sLog.outDetail("Opcodes: '%u'", opcode);
+
+	Origin::WatchdogPhase phase("WorldSocket::ProcessIncomingData", WATCHDOG_NO_VALUE, opcode);
 	try
 	{
 		switch (opcode)
 		{
 			case CMSG_AUTH_SESSION:
-				if (m_session)
+				if (HasSession())
 				{
 					sLog.outError("WorldSocket::ProcessIncomingData: Player send CMSG_AUTH_SESSION again");
 					return false;
@@ -182,21 +203,25 @@ bool WorldSocket::ProcessIncomingData()
 				return true;
 			default:
 			{
-				if (!m_session)
+				if (sPacketCapture.IsCapturing() && HasSession())
+					sPacketCapture.Capture(m_sessionHandle, m_accountId, *pct);
+
+				// fails as well once the session was deleted by the world thread
+				if (!sSessionTable.QueuePacket(SessionHandle(m_sessionHandle), std::move(pct)))
 				{
 					sLog.outError("WorldSocket::ProcessIncomingData: Client not authed opcode = %u", uint32(opcode));
 					return false;
 				}
 
-				m_session->QueuePacket(std::move(pct));
 				return true;
 			}
 		}
 	}
-	catch (ByteBufferException&)
+	catch (ByteBufferException& e)
 	{
+		e.PrintPosError();
 		sLog.outError("WorldSocket::ProcessIncomingData ByteBufferException occured while parsing an instant handled packet (opcode: %u) from client %s, accountid=%i.",
-			opcode, GetRemoteAddress().c_str(), m_session ? m_session->GetAccountId() : -1);
+			opcode, GetRemoteAddress().c_str(), GetSessionAccountId());
 
 		if (sLog.HasLogLevelOrHigher(LOG_LVL_DEBUG))
 		{
@@ -207,7 +232,7 @@ bool WorldSocket::ProcessIncomingData()
 		if (sWorld.getConfig(CONFIG_BOOL_KICK_PLAYER_ON_BAD_PACKET))
 		{
 			DETAIL_LOG("Disconnecting session [account id %i / address %s] for badly formatted packet.",
-				m_session ? m_session->GetAccountId() : -1, GetRemoteAddress().c_str());
+				GetSessionAccountId(), GetRemoteAddress().c_str());
 
 			return false;
 		}
@@ -230,9 +255,14 @@ bool WorldSocket::HandleAuthSession(WorldPacket &recvPacket)
 	uint32 build, id;
 	LocaleConstant locale;
 
-	recvPacket >> account;
-	recvPacket >> password;
-	recvPacket >> (uint32)build;
+	PacketReader reader(recvPacket);
+	reader >> account >> password >> build;
+	if (!reader)
+	{
+		sWorld.AddMalformedPacket();
+		DEBUG_LOG("WorldSocket::HandleAuthSession: malformed CMSG_AUTH_SESSION from %s", GetRemoteAddress().c_str());
+		return false;
+	}
 
 	sLog.outDetail("%s", account);
 	sLog.outDetail("%s", password);
@@ -256,20 +286,61 @@ bool WorldSocket::HandleAuthSession(WorldPacket &recvPacket)
 
 	delete result;
 
-	if (!(m_session = new WorldSession(id, this, AccountTypes(AccountTypes::SEC_PLAYER), mutetime, locale)))
-		return false;
-	sWorld.AddSession(m_session);
+	WorldSession* session = new WorldSession(id, this, AccountTypes(AccountTypes::SEC_PLAYER), mutetime, locale);
+	m_accountId = id;
+	m_lastPingReadTime = GetTime();
+	m_sessionHandle = session->GetHandle().GetRawValue();
+	sWorld.AddSession(session);
 	return true;
 }
 
+int32 WorldSocket::GetSessionAccountId() const
+{
+	int32 accountId = -1;
+	sSessionTable.Execute(SessionHandle(m_sessionHandle), [&accountId](WorldSession* session) { accountId = session->GetAccountId(); });
+	return accountId;
+}
+
+uint64 WorldSocket::GetTimeoutDeadline() const
+{
+	const uint64 ticksPerSecond = IN_MILLISECONDS / TimeoutTick;
+
+	if (!HasSession())
+	{
+		const uint32 handshakeTimeout = sWorld.getConfig(CONFIG_UINT32_SOCKET_HANDSHAKE_TIMEOUT);
+		return handshakeTimeout ? GetOpenTime() + handshakeTimeout * ticksPerSecond : 0;
+	}
+
+	uint64 deadline = 0;
+	if (const uint32 idleTimeout = sWorld.getConfig(CONFIG_UINT32_SOCKET_IDLE_TIMEOUT))
+		deadline = GetLastReadTime() + idleTimeout * ticksPerSecond;
+
+	if (const uint32 pingTimeout = sWorld.getConfig(CONFIG_UINT32_SOCKET_PING_TIMEOUT))
+	{
+		const uint64 pingDeadline = m_lastPingReadTime + pingTimeout * ticksPerSecond;
+		if (!deadline || pingDeadline < deadline)
+			deadline = pingDeadline;
+	}
+
+	return deadline;
+}
+
 bool WorldSocket::HandlePing(WorldPacket &recvPacket)
 {
 	uint32 ping;
 	uint32 latency;
 
 	// Get the ping packet content
-	recvPacket >> ping;
-	recvPacket >> latency;
+	PacketReader reader(recvPacket);
+	reader >> ping >> latency;
+	if (!reader)
+	{
+		sWorld.AddMalformedPacket();
+		DEBUG_LOG("WorldSocket::HandlePing: malformed CMSG_PING from %s", GetRemoteAddress().c_str());
+		return !sWorld.getConfig(CONFIG_BOOL_KICK_PLAYER_ON_BAD_PACKET);
+	}
+
+	m_lastPingReadTime = GetTime();
 
 	if (m_lastPingTime == std::chrono::system_clock::time_point::min())
 		m_lastPingTime = std::chrono::system_clock::now();              // for 1st ping
@@ -287,7 +358,9 @@ bool WorldSocket::HandlePing(WorldPacket &recvPacket)
 
 			if (max_count && m_overSpeedPings > max_count)
 			{
-				if (m_session && m_session->GetSecurity() == SEC_PLAYER)
+				bool isPlayer = false;
+				sSessionTable.Execute(SessionHandle(m_sessionHandle), [&isPlayer](WorldSession* session) { isPlayer = session->GetSecurity() == SEC_PLAYER; });
+				if (isPlayer)
 				{
 					sLog.outError("WorldSocket::HandlePing: Player kicked for "
 						"overspeeded pings address = %s",
@@ -303,12 +376,13 @@ bool WorldSocket::HandlePing(WorldPacket &recvPacket)
 
 	// critical section
 	{
-		if (m_session)
+		bool found = sSessionTable.Execute(SessionHandle(m_sessionHandle), [latency](WorldSession* session)
 		{
-			m_session->SetLatency(latency);
-			m_session->ResetClientTimeDelay();
-		}
-		else
+			session->SetLatency(latency);
+			session->ResetClientTimeDelay();
+		});
+
+		if (!found)
 		{
 			sLog.outError("WorldSocket::HandlePing: peer sent CMSG_PING, "
 				"but is not authenticated or got recently kicked,"
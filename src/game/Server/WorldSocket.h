@@ -8,6 +8,7 @@
 
 #include <chrono>
 #include <functional>
+#include <atomic>
 
 class WorldPacket;
 class WorldSession;
@@ -30,16 +31,22 @@ struct ClientPktHeader
 	/// Keep track of over-speed pings ,to prevent ping flood.
 	uint32 m_overSpeedPings;
 
+	/// Network thread wheel time of the last CMSG_PING (or of the login), for Network.PingTimeout
+	uint64 m_lastPingReadTime;
+
 	ClientPktHeader m_existingHeader;
 	bool m_useExistingHeader;
 
 	/// Class used for managing encryption of the headers
 	AuthCrypt m_crypt;
 
-	/// Session to which received packets are routed
-	WorldSession *m_session;
+	/// Raw SessionHandle of the session to which received packets are routed, 0 when there is none
+	std::atomic<uint64> m_sessionHandle;
 	bool m_sessionFinalized;
 
+	/// Account of the session, kept here so packet captures do not look the session up per packet
+	uint32 m_accountId;
+
 	const uint32 m_seed;
 
 	BigNumber m_s;
@@ -53,16 +60,26 @@ struct ClientPktHeader
 	/// Called by ProcessIncoming() on CMSG_PING.
 	bool HandlePing(WorldPacket &recvPacket);
 
+	/// Lane of an outgoing packet
+	static SendLane GetSendLane(uint16 opcode, bool immediate);
+
+	bool HasSession() const { return m_sessionHandle != 0; }
+	/// account id of the session for logging, -1 if there is none
+	int32 GetSessionAccountId() const;
+
+	/// Handshake timeout until authed, then the earlier of the idle and ping timeouts
+	virtual uint64 GetTimeoutDeadline() const override;
+
 public:
 	WorldSocket(boost::asio::io_service &service, std::function<void(Socket *)> closeHandler);
 
 	// send a packet \o/
 	void SendPacket(const WorldPacket& pct, bool immediate = false);
 
-	void ClearSession() { m_session = nullptr; }
+	void ClearSession() { m_sessionHandle = 0; }
 
 	virtual bool Open() override;
-	virtual bool Deletable() const override { return !m_session && Socket::Deletable(); }
+	virtual bool Deletable() const override { return !HasSession() && Socket::Deletable(); }
 
 	/// Return the session key
 	BigNumber &GetSessionKey() { return m_s; }
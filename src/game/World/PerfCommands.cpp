@@ -0,0 +1,215 @@
+#include "PerfCommands.h"
+#include <Database/DatabaseEnv.h>
+#include <Network/Scoket.h>
+#include <Watchdog.h>
+
+#include "../Server/WorldSession.h"
+#include "../Server/Opcodes.h"
+#include "../Server/PacketCapture.h"
+#include "../Map/MapManager.h"
+#include "ObjectAccessor.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define PERF_DEFAULT_OPCODE_LIMIT 20
+
+/// histogram column header, "<250us", "<2.5ms", the open ended last bucket is "more"
+static void FormatBucketLimit(uint32 limit, char (&column)[16])
+{
+	if (!limit)
+		snprintf(column, sizeof(column), " %7s", "more");
+	else if (limit < 1000)
+		snprintf(column, sizeof(column), "  <%3uus", limit);
+	else if (limit % 1000)
+		snprintf(column, sizeof(column), " <%4.1fms", limit / 1000.0f);
+	else
+		snprintf(column, sizeof(column), "  <%3ums", limit / 1000);
+}
+
+bool PerfCommands::Handle(char const* args, CliCommandHolder::Print const& print)
+{
+	while (*args == ' ')
+		++args;
+
+	char subcommand[32] = "";
+	uint32 limit = 0;
+	sscanf(args, "%31s %u", subcommand, &limit);
+
+	if (!*subcommand || !strcmp(subcommand, "summary"))
+		HandleSummary(print);
+	else if (!strcmp(subcommand, "phases"))
+		HandlePhases(print);
+	else if (!strcmp(subcommand, "maps"))
+		HandleMaps(print);
+	else if (!strcmp(subcommand, "opcodes"))
+		HandleOpcodes(print, limit ? limit : PERF_DEFAULT_OPCODE_LIMIT);
+	else if (!strcmp(subcommand, "db"))
+		HandleDatabase(print);
+	else if (!strcmp(subcommand, "net"))
+		HandleNetwork(print);
+	else if (!strcmp(subcommand, "sessions"))
+		HandleSessions(print);
+	else if (!strcmp(subcommand, "stalls"))
+	{
+		Origin::Watchdog::DumpBreadcrumbs();
+		PSendLine(print, "Watchdog breadcrumbs written to the error log, %u near-stalls so far", Origin::Watchdog::GetNearStallCount());
+	}
+	else if (!strcmp(subcommand, "reset"))
+		HandleReset(print);
+	else
+	{
+		PSendLine(print, "Usage: .perf [summary|phases|maps|opcodes [count]|db|net|sessions|stalls|reset]");
+		return false;
+	}
+
+	return true;
+}
+
+void PerfCommands::HandleSummary(CliCommandHolder::Print const& print)
+{
+	HandleSessions(print);
+	HandleNetwork(print);
+	HandleDatabase(print);
+	PSendLine(print, "Watchdog: %u near-stalls (>= %u ms), see .perf stalls", Origin::Watchdog::GetNearStallCount(), Origin::Watchdog::GetNearStallTime());
+}
+
+void PerfCommands::HandlePhases(CliCommandHolder::Print const& print)
+{
+	std::vector<Origin::WatchdogPhaseStats const*> phases;
+	for (uint32 i = 0; i < WATCHDOG_MAX_PHASES; ++i)
+	{
+		Origin::WatchdogPhaseStats const& stats = Origin::Watchdog::GetPhaseStats(i);
+		if (stats.phase.load(std::memory_order_acquire) && stats.count.load(std::memory_order_relaxed))
+			phases.push_back(&stats);
+	}
+
+	std::sort(phases.begin(), phases.end(), [](Origin::WatchdogPhaseStats const* a, Origin::WatchdogPhaseStats const* b)
+	{
+		return a->totalTime.load(std::memory_order_relaxed) > b->totalTime.load(std::memory_order_relaxed);
+	});
+
+	std::string header;
+	for (uint32 b = 0; b < WATCHDOG_PHASE_BUCKETS; ++b)
+	{
+		char column[16];
+		FormatBucketLimit(Origin::Watchdog::GetPhaseBucketLimit(b), column);
+		header += column;
+	}
+
+	PSendLine(print, "Tick phases by total time (us), all threads:");
+	PSendLine(print, "%-36s %10s %12s %8s %8s%s", "phase", "count", "total", "avg", "max", header.c_str());
+	for (size_t i = 0; i < phases.size(); ++i)
+	{
+		Origin::WatchdogPhaseStats const& stats = *phases[i];
+		uint64 count = stats.count.load(std::memory_order_relaxed);
+		uint64 total = stats.totalTime.load(std::memory_order_relaxed);
+
+		std::string histogram;
+		for (uint32 b = 0; b < WATCHDOG_PHASE_BUCKETS; ++b)
+		{
+			char column[16];
+			snprintf(column, sizeof(column), " %7llu", (unsigned long long)stats.histogram[b].load(std::memory_order_relaxed));
+			histogram += column;
+		}
+
+		PSendLine(print, "%-36s %10llu %12llu %8llu %8u%s", stats.phase.load(std::memory_order_relaxed), (unsigned long long)count,
+			(unsigned long long)total, (unsigned long long)(total / count), stats.maxTime.load(std::memory_order_relaxed), histogram.c_str());
+	}
+}
+
+void PerfCommands::HandleMaps(CliCommandHolder::Print const& print)
+{
+	MapManager::MapMapType const& maps = sMapMgr.Maps();
+
+	PSendLine(print, "Map updates (us), %u maps:", uint32(maps.size()));
+	PSendLine(print, "%6s %8s %7s %10s %8s %8s %8s %s", "map", "instance", "players", "updates", "avg", "last", "max", "state");
+	for (MapManager::MapMapType::const_iterator itr = maps.begin(); itr != maps.end(); ++itr)
+	{
+		Map const* map = itr->second;
+		MapUpdateStats const& stats = map->GetUpdateStats();
+		PSendLine(print, "%6u %8u %7u %10u %8llu %8u %8u %s", map->GetId(), map->GetInstanceId(), map->GetPlayers().getSize(), stats.count,
+			(unsigned long long)(stats.count ? stats.totalTime / stats.count : 0), stats.lastTime, stats.maxTime, map->IsHibernating() ? "hibernating" : "awake");
+	}
+}
+
+void PerfCommands::HandleOpcodes(CliCommandHolder::Print const& print, uint32 limit)
+{
+	std::vector<uint32> opcodes;
+	for (uint32 opcode = 0; opcode < NUM_MSG_TYPES; ++opcode)
+		if (WorldSession::GetOpcodeStats(opcode).count.load(std::memory_order_relaxed))
+			opcodes.push_back(opcode);
+
+	std::sort(opcodes.begin(), opcodes.end(), [](uint32 a, uint32 b)
+	{
+		return WorldSession::GetOpcodeStats(a).totalTime.load(std::memory_order_relaxed) > WorldSession::GetOpcodeStats(b).totalTime.load(std::memory_order_relaxed);
+	});
+	if (opcodes.size() > limit)
+		opcodes.resize(limit);
+
+	PSendLine(print, "Handled opcodes by total handler time (us):");
+	PSendLine(print, "%-28s %6s %10s %12s %8s %8s", "opcode", "id", "count", "total", "avg", "max");
+	for (size_t i = 0; i < opcodes.size(); ++i)
+	{
+		OpcodeStats const& stats = WorldSession::GetOpcodeStats(opcodes[i]);
+		uint64 count = stats.count.load(std::memory_order_relaxed);
+		uint64 total = stats.totalTime.load(std::memory_order_relaxed);
+		PSendLine(print, "%-28s 0x%04X %10llu %12llu %8llu %8u", LookupOpcodeName(uint16(opcodes[i])), opcodes[i], (unsigned long long)count,
+			(unsigned long long)total, (unsigned long long)(total / count), stats.maxTime.load(std::memory_order_relaxed));
+	}
+}
+
+void PerfCommands::HandleDatabase(CliCommandHolder::Print const& print)
+{
+	PSendLine(print, "DB queues (delayed statements / pending results): world %u / %u, character %u / %u, login %u / %u",
+		uint32(WorldDatabase.GetDelayQueueSize()), uint32(WorldDatabase.GetResultQueueSize()),
+		uint32(CharacterDatabase.GetDelayQueueSize()), uint32(CharacterDatabase.GetResultQueueSize()),
+		uint32(LoginDatabase.GetDelayQueueSize()), uint32(LoginDatabase.GetResultQueueSize()));
+}
+
+void PerfCommands::HandleNetwork(CliCommandHolder::Print const& print)
+{
+	Origin::SocketStats const& stats = Origin::Socket::GetStats();
+	PSendLine(print, "Sockets: %u open, " UI64FMTD " timed out, " UI64FMTD " bytes received, " UI64FMTD " bytes sent, " SI64FMTD " bytes waiting to be sent",
+		stats.openSockets.load(), stats.timedOut.load(), stats.bytesReceived.load(), stats.bytesSent.load(), stats.bytesQueued.load());
+
+	if (sPacketCapture.IsCapturing())
+		PSendLine(print, "Packet capture: " UI64FMTD " packets captured, " UI64FMTD " dropped", sPacketCapture.GetRecordCount(), sPacketCapture.GetDroppedCount());
+}
+
+void PerfCommands::HandleSessions(CliCommandHolder::Print const& print)
+{
+	PSendLine(print, "Sessions: %u active, %u queued, %u max active, %u players, uptime %u s",
+		sWorld.GetActiveSessionCount(), sWorld.GetQueuedSessionCount(), sWorld.GetMaxActiveSessionCount(),
+		uint32(sObjectAccessor.GetPlayers().size()), sWorld.GetUptime());
+	PSendLine(print, "Packet budget: " UI64FMTD " overruns, " UI64FMTD " packets deferred, " UI64FMTD " malformed packets",
+		sWorld.GetPacketBudgetOverruns(), sWorld.GetPacketBudgetDeferred(), sWorld.GetMalformedPacketCount());
+}
+
+void PerfCommands::HandleReset(CliCommandHolder::Print const& print)
+{
+	Origin::Watchdog::ResetPhaseStats();
+	WorldSession::ResetOpcodeStats();
+
+	MapManager::MapMapType const& maps = sMapMgr.Maps();
+	for (MapManager::MapMapType::const_iterator itr = maps.begin(); itr != maps.end(); ++itr)
+		itr->second->ResetUpdateStats();
+
+	PSendLine(print, "Phase, opcode and map statistics reset");
+}
+
+void PerfCommands::PSendLine(CliCommandHolder::Print const& print, char const* format, ...)
+{
+	char line[1024];
+
+	va_list ap;
+	va_start(ap, format);
+	vsnprintf(line, sizeof(line) - 1, format, ap);
+	va_end(ap);
+
+	strcat(line, "\n");
+	print(line);
+}
@@ -0,0 +1,28 @@
+#ifndef ORIGIN_PERFCOMMANDS_H
+#define ORIGIN_PERFCOMMANDS_H
+
+#include <Common.h>
+#include "World.h"
+
+/// .perf console commands, run by World::ProcessCliCommands on the world thread.
+/// They only read counters which are kept anyway, so they are safe to use on a loaded realm.
+class PerfCommands
+{
+public:
+	/// args is the text after ".perf", false for an unknown subcommand
+	static bool Handle(char const* args, CliCommandHolder::Print const& print);
+
+private:
+	static void HandleSummary(CliCommandHolder::Print const& print);
+	static void HandlePhases(CliCommandHolder::Print const& print);
+	static void HandleMaps(CliCommandHolder::Print const& print);
+	static void HandleOpcodes(CliCommandHolder::Print const& print, uint32 limit);
+	static void HandleDatabase(CliCommandHolder::Print const& print);
+	static void HandleNetwork(CliCommandHolder::Print const& print);
+	static void HandleSessions(CliCommandHolder::Print const& print);
+	static void HandleReset(CliCommandHolder::Print const& print);
+
+	static void PSendLine(CliCommandHolder::Print const& print, char const* format, ...) ATTR_PRINTF(2, 3);
+};
+
+#endif
@@ -6,8 +6,12 @@
 #include <Define.h>
 #include <Log.h>
 #include <Util.h>
+#include <Watchdog.h>
+#include <GameClock.h>
 
 #include "../Server/WorldSession.h"
+#include "../Server/PacketCapture.h"
+#include "PerfCommands.h"
 #include "WorldPacket.h"
 #include "Player.h"
 #include "ObjectMgr.h"
@@ -59,6 +63,7 @@ float World::m_VisibleObjectGreyDistance = 0;
 
 float  World::m_relocation_lower_limit_sq = 10.f * 10.f;
 uint32 World::m_relocation_ai_notify_delay = 1000u;
+uint32 World::m_relocation_player_notify_delay = 250u;
 
 World::World() : mail_timer(0), mail_timer_expires(0)
 {
@@ -70,6 +75,16 @@ World::World() : mail_timer(0), mail_timer_expires(0)
 	m_startTime = m_gameTime;
 	m_maxActiveSessionCount = 0;
 	m_maxQueuedSessionCount = 0;
+	m_queueHeadTicket = 0;
+	m_queuedSessionCount = 0;
+	m_queuePositionsChanged = false;
+	m_populationChanged = false;
+	m_uptimeChanged = false;
+	m_sessionUpdateCursor = 0;
+	m_updateTick = 0;
+	m_packetBudgetOverruns = 0;
+	m_packetBudgetDeferred = 0;
+	m_malformedPackets = 0;
 	m_defaultDbcLocale = LOCALE_enUS;
 	m_availableDbcLocaleMask = 0;
 
@@ -104,12 +119,23 @@ void World::CleanupsBeforeStop()
 {
 	KickAll();                                       // save and kick all players
 	UpdateSessions(1);                               // real players unload required UpdateSessions call
+	FlushRealmBookkeeping();                         // write logouts of the kicked players
+	sPacketCapture.Stop();
+	sPacketReplay.Stop();
 	//sBattleGroundMgr.DeleteAllBattleGrounds();       // unload battleground templates before different singletons destroyed
 }
 /// Kick (and save) all players
 void World::KickAll()
 {
-	m_QueuedSessions.clear();                               // prevent send queue update packet and login queued sessions
+	// prevent send queue update packet and login queued sessions
+	for (Queue::const_iterator iter = m_QueuedSessions.begin(); iter != m_QueuedSessions.end(); ++iter)
+		if (*iter)
+			(*iter)->SetInQueue(false);
+
+	m_queueHeadTicket += m_QueuedSessions.size();
+	m_QueuedSessions.clear();
+	m_queuedSessionCount = 0;
+	m_queuePositionsChanged = false;
 
 															// session not removed at kick and will removed in next update tick
 	for (SessionMap::const_iterator itr = m_sessions.begin(); itr != m_sessions.end(); ++itr)
@@ -231,12 +257,29 @@ void World::LoadConfigSettings(bool reload)
 	setConfig(CONFIG_BOOL_CLEAN_CHARACTER_DB, "CleanCharacterDB", true);
 	setConfig(CONFIG_UINT32_MAX_WHOLIST_RETURNS, "MaxWhoListReturns", 49);
 
+	setConfigMin(CONFIG_UINT32_QUEUE_UPDATE_INTERVAL, "PlayerLimit.QueueUpdateInterval", 5 * IN_MILLISECONDS, 500);
+	if (reload)
+		m_timers[WUPDATE_QUEUE].SetInterval(getConfig(CONFIG_UINT32_QUEUE_UPDATE_INTERVAL));
+
+	setConfigMin(CONFIG_UINT32_BOOKKEEPING_FLUSH_INTERVAL, "RealmBookkeeping.FlushInterval", 10 * IN_MILLISECONDS, IN_MILLISECONDS);
+	if (reload)
+		m_timers[WUPDATE_BOOKKEEPING].SetInterval(getConfig(CONFIG_UINT32_BOOKKEEPING_FLUSH_INTERVAL));
+
 	
 	setConfig(CONFIG_UINT32_INTERVAL_SAVE, "PlayerSave.Interval", 15 * MINUTE * IN_MILLISECONDS);
 	setConfigMinMax(CONFIG_UINT32_MIN_LEVEL_STAT_SAVE, "PlayerSave.Stats.MinLevel", 0, 0, MAX_LEVEL);
 	setConfig(CONFIG_BOOL_STATS_SAVE_ONLY_ON_LOGOUT, "PlayerSave.Stats.SaveOnlyOnLogout", true);
 
 	setConfigMin(CONFIG_UINT32_INTERVAL_MAPUPDATE, "MapUpdateInterval", 100, MIN_MAP_UPDATE_DELAY);
+	// maps are split into square regions updated in parallel by MapUpdate.Threads threads (the world thread included)
+	if (configNoReload(reload, CONFIG_UINT32_MAP_UPDATE_THREADS, "MapUpdate.Threads", 1))
+		setConfigMinMax(CONFIG_UINT32_MAP_UPDATE_THREADS, "MapUpdate.Threads", 1, 1, MAP_WORKER_MAX_THREADS);
+	if (configNoReload(reload, CONFIG_FLOAT_MAP_REGION_SIZE, "MapUpdate.RegionSize", DEFAULT_MAP_REGION_SIZE))
+		setConfigMin(CONFIG_FLOAT_MAP_REGION_SIZE, "MapUpdate.RegionSize", DEFAULT_MAP_REGION_SIZE, MIN_MAP_REGION_SIZE);
+	// maps without players hibernate after the delay (0 never) and are then only updated every interval
+	setConfig(CONFIG_UINT32_MAP_HIBERNATE_DELAY, "MapUpdate.HibernateDelay", MINUTE * IN_MILLISECONDS);
+	setConfigMin(CONFIG_UINT32_MAP_HIBERNATE_INTERVAL, "MapUpdate.HibernateInterval", 10 * IN_MILLISECONDS, MIN_MAP_UPDATE_DELAY);
+	setConfig(CONFIG_BOOL_MAP_HIBERNATE_RELEASE_BUFFERS, "MapUpdate.HibernateReleaseBuffers", true);
 	/*if (reload)
 		sMapMgr.SetMapUpdateInterval(getConfig(CONFIG_UINT32_INTERVAL_MAPUPDATE));*/
 
@@ -365,6 +408,11 @@ void World::LoadConfigSettings(bool reload)
 		setConfig(CONFIG_UINT32_MAX_OVERSPEED_PINGS, 2);
 	}
 
+	// seconds, 0 disables: connected without CMSG_AUTH_SESSION, authed without any data, authed without CMSG_PING
+	setConfig(CONFIG_UINT32_SOCKET_HANDSHAKE_TIMEOUT, "Network.HandshakeTimeout", 30);
+	setConfig(CONFIG_UINT32_SOCKET_IDLE_TIMEOUT, "Network.IdleTimeout", 90);
+	setConfig(CONFIG_UINT32_SOCKET_PING_TIMEOUT, "Network.PingTimeout", 180);
+
 	setConfig(CONFIG_BOOL_SAVE_RESPAWN_TIME_IMMEDIATELY, "SaveRespawnTimeImmediately", true);
 	setConfig(CONFIG_BOOL_WEATHER, "ActivateWeather", true);
 
@@ -426,6 +474,8 @@ void World::LoadConfigSettings(bool reload)
 	setConfig(CONFIG_BOOL_OUTDOORPVP_EP_ENABLED, "OutdoorPvp.EPEnabled", true);
 
 	setConfig(CONFIG_BOOL_KICK_PLAYER_ON_BAD_PACKET, "Network.KickOnBadPacket", false);
+	setConfig(CONFIG_UINT32_PACKET_BUDGET_COUNT, "Network.PacketBudget.Count", 100);
+	setConfig(CONFIG_UINT32_PACKET_BUDGET_TIME, "Network.PacketBudget.Time", 10);
 
 	setConfig(CONFIG_BOOL_PLAYER_COMMANDS, "PlayerCommands", true);
 
@@ -444,6 +494,7 @@ void World::LoadConfigSettings(bool reload)
 
 	m_relocation_ai_notify_delay = sConfig.GetIntDefault("Visibility.AIRelocationNotifyDelay", 1000u);
 	m_relocation_lower_limit_sq = pow(sConfig.GetFloatDefault("Visibility.RelocationLowerLimit", 10), 2);
+	m_relocation_player_notify_delay = sConfig.GetIntDefault("Visibility.PlayerRelocationNotifyDelay", 250u);
 
 	m_VisibleUnitGreyDistance = sConfig.GetFloatDefault("Visibility.Distance.Grey.Unit", 1);
 	if (m_VisibleUnitGreyDistance >  MAX_VISIBILITY_DISTANCE)
@@ -504,6 +555,18 @@ void World::LoadConfigSettings(bool reload)
 		m_MaxVisibleDistanceInFlight = MAX_VISIBILITY_DISTANCE - m_VisibleObjectGreyDistance;
 	}
 
+	// side of the cells maps sort players into for visibility, 0 uses the visibility distance of the map
+	setConfigPos(CONFIG_FLOAT_VISIBILITY_CELL_SIZE, "Visibility.CellSize", 0.0f);
+
+	// players further than the near distance get the movement and values of others every mid interval (map ticks),
+	// further than the mid distance only the movement every far interval. The tick budget (bytes, 0 no limit) of
+	// an observer drops far updates first, then mid ones.
+	setConfigPos(CONFIG_FLOAT_VISIBILITY_LOD_NEAR_DISTANCE, "Visibility.LOD.NearDistance", 30.0f);
+	setConfigPos(CONFIG_FLOAT_VISIBILITY_LOD_MID_DISTANCE, "Visibility.LOD.MidDistance", 60.0f);
+	setConfigMin(CONFIG_UINT32_VISIBILITY_LOD_MID_INTERVAL, "Visibility.LOD.MidInterval", 3, 1);
+	setConfigMin(CONFIG_UINT32_VISIBILITY_LOD_FAR_INTERVAL, "Visibility.LOD.FarInterval", 10, 1);
+	setConfig(CONFIG_UINT32_VISIBILITY_LOD_TICK_BUDGET, "Visibility.LOD.TickBudget", 0);
+
 	///- Load the CharDelete related config options
 	setConfigMinMax(CONFIG_UINT32_CHARDELETE_METHOD, "CharDelete.Method", 0, 0, 1);
 	setConfigMinMax(CONFIG_UINT32_CHARDELETE_MIN_LEVEL, "CharDelete.MinLevel", 0, 0, getConfig(CONFIG_UINT32_MAX_PLAYER_LEVEL));
@@ -867,6 +930,12 @@ void World::SetInitialWorldSettings()
 																	  // for AhBot
 	m_timers[WUPDATE_AHBOT].SetInterval(20 * IN_MILLISECONDS); // every 20 sec
 
+	// queued sessions get their new position in batches
+	m_timers[WUPDATE_QUEUE].SetInterval(getConfig(CONFIG_UINT32_QUEUE_UPDATE_INTERVAL));
+
+	// population, uptime and logout writes are batched
+	m_timers[WUPDATE_BOOKKEEPING].SetInterval(getConfig(CONFIG_UINT32_BOOKKEEPING_FLUSH_INTERVAL));
+
 															   // to set mailtimer to return mails every day between 4 and 5 am
 															   // mailtimer is increased when updating auctions
 															   // one second is 1000 -(tested on win system)
@@ -915,6 +984,15 @@ void World::SetInitialWorldSettings()
 	sLog.outString("Initialize AuctionHouseBot...");
 	sLog.outString();
 
+	///- Capture inbound packets, or replay a capture instead of serving clients
+	std::string captureFile = sConfig.GetStringDefault("Network.Capture.File", "");
+	if (!captureFile.empty())
+		sPacketCapture.Start(captureFile);
+
+	std::string replayFile = sConfig.GetStringDefault("Network.Replay.File", "");
+	if (!replayFile.empty())
+		sPacketReplay.Start(replayFile, PacketReplay::Timing(sConfig.GetIntDefault("Network.Replay.Timing", PacketReplay::REPLAY_TIMING_TICK)));
+
 	sLog.outString("---------------------------------------");
 	sLog.outString("      ORIGIN : World initialized       ");
 	sLog.outString("---------------------------------------");
@@ -1148,6 +1226,12 @@ void World::ServerMaintenanceStart()
 			*/
 	CharacterDatabase.PExecute("UPDATE saved_variables SET NextMaintenanceDate = '" UI64FMTD "'", uint64(m_NextMaintenanceDate));
 }
+/// Update the game time and the cached clocks
+void World::_UpdateGameTime()
+{
+	GameClock::Update();
+	m_gameTime = GameClock::GetGameTime();
+}
 void World::UpdateResultQueue()
 {
 	// process async result queues
@@ -1158,16 +1242,49 @@ void World::UpdateResultQueue()
 /// Update the World !
 void World::Update(uint32 diff)
 {
+	///- Sample the clocks read by sessions, players and the log during this tick
+	_UpdateGameTime();
+	++m_updateTick;
+
+	///- Update the different timers
+	for (int i = 0; i < WUPDATE_COUNT; ++i)
+	{
+		if (m_timers[i].GetCurrent() >= 0)
+			m_timers[i].Update(diff);
+		else
+			m_timers[i].SetCurrent(0);
+	}
+
+	/// <li> Queue the replayed packets due this tick
+	if (sPacketReplay.IsReplaying())
+	{
+		Origin::WatchdogPhase phase("PacketReplay::Update");
+		sPacketReplay.Update(diff);
+	}
 	/// <li> Handle session updates
-	UpdateSessions(diff);
+	{
+		Origin::WatchdogPhase phase("World::UpdateSessions");
+		UpdateSessions(diff);
+	}
+	/// <li> Send new positions to the login queue
+	if (m_timers[WUPDATE_QUEUE].Passed())
+	{
+		Origin::WatchdogPhase phase("World::UpdateQueuedSessionPositions");
+		m_timers[WUPDATE_QUEUE].Reset();
+		UpdateQueuedSessionPositions();
+	}
 	/// <li> Update uptime table
 	if (m_timers[WUPDATE_UPTIME].Passed())
 	{
-		uint32 tmpDiff = uint32(m_gameTime - m_startTime);
-		uint32 maxClientsNum = GetMaxActiveSessionCount();
-
 		m_timers[WUPDATE_UPTIME].Reset();
-		LoginDatabase.PExecute("UPDATE uptime SET uptime = %u, maxplayers = %u WHERE realmid = %u AND starttime = " UI64FMTD, tmpDiff, maxClientsNum, realmID, uint64(m_startTime));
+		m_uptimeChanged = true;
+	}
+	/// <li> Write realm bookkeeping collected since the last flush
+	if (m_timers[WUPDATE_BOOKKEEPING].Passed())
+	{
+		Origin::WatchdogPhase phase("World::FlushRealmBookkeeping");
+		m_timers[WUPDATE_BOOKKEEPING].Reset();
+		FlushRealmBookkeeping();
 	}
 	/// <li> Handle all other objects
 	///- Update objects (maps, transport, creatures,...)
@@ -1176,14 +1293,28 @@ void World::Update(uint32 diff)
 	/// delete old character
 
 	// execute callbacks from sql queries that were queued recently
-	UpdateResultQueue();
+	{
+		Origin::WatchdogPhase phase("World::UpdateResultQueue");
+		UpdateResultQueue();
+	}
 
 	/// process game event
 
 	/// </ul>
 	///- Move all creatures with "delayed move" and remove and delete all objects with "delayed remove"
-	sMapMgr.RemoveAllObjectsInRemoveList();
+	{
+		Origin::WatchdogPhase phase("MapManager::RemoveAllObjectsInRemoveList");
+		sMapMgr.RemoveAllObjectsInRemoveList();
+	}
+
+	/// <li> Write the packets captured during this tick
+	if (sPacketCapture.IsCapturing())
+	{
+		Origin::WatchdogPhase phase("PacketCapture::Flush");
+		sPacketCapture.Flush();
+	}
 
+	Origin::WatchdogPhase phase("World::ProcessCliCommands");
 	ProcessCliCommands();
 }
 void World::ProcessCliCommands()
@@ -1200,8 +1331,16 @@ void World::ProcessCliCommands()
 		//CliHandler handler(command->m_cliAccountId, command->m_cliAccessLevel, command->m_print);
 		//handler.ParseCommands(&command->m_command[0]);
 
-		//if (command->m_commandFinished)
-			//command->m_commandFinished(!handler.HasSentErrorMessage());
+		// until there is a chat command table only the world thread commands are known here
+		char const* text = &command->m_command[0];
+		bool success = false;
+		if (!strncmp(text, ".perf", 5) && (!text[5] || text[5] == ' '))
+			success = PerfCommands::Handle(text + 5, command->m_print);
+		else if (command->m_print)
+			command->m_print("Unknown command\n");
+
+		if (command->m_commandFinished)
+			command->m_commandFinished(success);
 
 		delete command;
 	}
@@ -1217,30 +1356,32 @@ bool World::RemoveQueuedSession(WorldSession* sess)
 	// sessions count including queued to remove (if removed_session set)
 	uint32 sessions = GetActiveSessionCount();
 
-	uint32 position = 1;
-	Queue::iterator iter = m_QueuedSessions.begin();
-
-	// search to remove and count skipped positions
+	// the ticket gives the queue slot directly, leave a hole that the next position update compacts
 	bool found = false;
-
-	for (; iter != m_QueuedSessions.end(); ++iter, ++position)
+	if (sess->IsInQueue())
 	{
-		if (*iter == sess)
+		uint32 slot = sess->GetQueueTicket() - m_queueHeadTicket;
+		if (slot < m_QueuedSessions.size() && m_QueuedSessions[slot] == sess)
 		{
 			sess->SetInQueue(false);
-			iter = m_QueuedSessions.erase(iter);
+			m_QueuedSessions[slot] = nullptr;
+			--m_queuedSessionCount;
+			m_queuePositionsChanged = true;
 			found = true;                                   // removing queued session
-			break;
 		}
 	}
 
-	// iter point to next socked after removed or end()
-	// position store position of removed socket and then new position next socket after removed
-
 	// if session not queued then we need decrease sessions count
 	if (!found && sessions)
 		--sessions;
 
+	// skip holes left by sessions which left the queue
+	while (!m_QueuedSessions.empty() && !m_QueuedSessions.front())
+	{
+		m_QueuedSessions.pop_front();
+		++m_queueHeadTicket;
+	}
+
 	// accept first in queue
 	if ((!m_playerLimit || (int32)sessions < m_playerLimit) && !m_QueuedSessions.empty())
 	{
@@ -1248,28 +1389,121 @@ bool World::RemoveQueuedSession(WorldSession* sess)
 		pop_sess->SetInQueue(false);
 		pop_sess->SendAuthWaitQue(0);
 		m_QueuedSessions.pop_front();
+		++m_queueHeadTicket;
+		--m_queuedSessionCount;
+		m_queuePositionsChanged = true;
+	}
+
+	// the sessions behind get their new position with the next batched update
+	return found;
+}
+void World::UpdateQueuedSessionPositions()
+{
+	if (!m_queuePositionsChanged)
+		return;
+
+	m_queuePositionsChanged = false;
+
+	// compact the queue and hand out new tickets, only clients whose position changed are notified
+	Queue compacted;
+	for (Queue::const_iterator iter = m_QueuedSessions.begin(); iter != m_QueuedSessions.end(); ++iter)
+	{
+		WorldSession* sess = *iter;
+		if (!sess)
+			continue;
+
+		uint32 position = compacted.size() + 1;
+		sess->SetQueueTicket(m_queueHeadTicket + compacted.size());
+		compacted.push_back(sess);
+
+		if (sess->GetQueuePos() != position)
+		{
+			sess->SetQueuePos(position);
+			sess->SendAuthWaitQue(position);
+		}
+	}
+
+	m_QueuedSessions.swap(compacted);
+}
+void World::QueueAccountLogout(uint32 accountId)
+{
+	std::lock_guard<std::mutex> guard(m_bookkeepingLock);
+	m_pendingLogoutAccounts.push_back(accountId);
+}
+void World::FlushRealmBookkeeping()
+{
+	std::vector<uint32> logoutAccounts;
+	{
+		std::lock_guard<std::mutex> guard(m_bookkeepingLock);
+		logoutAccounts.swap(m_pendingLogoutAccounts);
+	}
 
-		// update iter to point first queued socket or end() if queue is empty now
-		iter = m_QueuedSessions.begin();
-		position = 1;
+	if (!m_populationChanged && !m_uptimeChanged && logoutAccounts.empty())
+		return;
+
+	// No SQL injection as AccountIds are uint32, split so that one statement stays below MAX_QUERY_LEN
+	std::vector<std::string> accountLists;
+	for (size_t i = 0; i < logoutAccounts.size(); i += 1000)
+	{
+		std::ostringstream accountList;
+		for (size_t j = i; j < logoutAccounts.size() && j < i + 1000; ++j)
+			accountList << (j == i ? "" : ",") << logoutAccounts[j];
+		accountLists.push_back(accountList.str());
 	}
 
-	// update position from iter to end()
-	// iter point to first not updated socket, position store new position
-	for (; iter != m_QueuedSessions.end(); ++iter, ++position)
-		(*iter)->SendAuthWaitQue(position);
+	LoginDatabase.BeginTransaction();
 
-	return found;
+	if (m_populationChanged)
+	{
+		uint32 pLimit = GetPlayerAmountLimit();
+		if (pLimit > 0)
+		{
+			float popu = float(GetActiveSessionCount());    // updated number of users on the server
+			popu /= pLimit;
+			popu *= 2;
+
+			static SqlStatementID id;
+
+			SqlStatement stmt = LoginDatabase.CreateStatement(id, "UPDATE realmlist SET population = ? WHERE id = ?");
+			stmt.PExecute(popu, realmID);
+
+			DETAIL_LOG("Server Population (%f).", popu);
+		}
+		m_populationChanged = false;
+	}
+
+	if (m_uptimeChanged)
+	{
+		uint32 tmpDiff = uint32(m_gameTime - m_startTime);
+		uint32 maxClientsNum = GetMaxActiveSessionCount();
+
+		LoginDatabase.PExecute("UPDATE uptime SET uptime = %u, maxplayers = %u WHERE realmid = %u AND starttime = " UI64FMTD, tmpDiff, maxClientsNum, realmID, uint64(m_startTime));
+		m_uptimeChanged = false;
+	}
+
+	for (std::vector<std::string>::const_iterator itr = accountLists.begin(); itr != accountLists.end(); ++itr)
+		LoginDatabase.PExecute("UPDATE account SET active_realm_id = 0 WHERE id IN (%s)", itr->c_str());
+
+	LoginDatabase.CommitTransaction();
+
+	///- Since each account can only have one online character at any given time, ensure all characters for logged out accounts are marked as offline
+	for (std::vector<std::string>::const_iterator itr = accountLists.begin(); itr != accountLists.end(); ++itr)
+		CharacterDatabase.PExecute("UPDATE characters SET online = 0 WHERE account IN (%s)", itr->c_str());
 }
 void World::UpdateMaxSessionCounters()
 {
-	m_maxActiveSessionCount = std::max(m_maxActiveSessionCount, uint32(m_sessions.size() - m_QueuedSessions.size()));
-	m_maxQueuedSessionCount = std::max(m_maxQueuedSessionCount, uint32(m_QueuedSessions.size()));
+	m_maxActiveSessionCount = std::max(m_maxActiveSessionCount, GetActiveSessionCount());
+	m_maxQueuedSessionCount = std::max(m_maxQueuedSessionCount, GetQueuedSessionCount());
 }
 void World::AddQueuedSession(WorldSession* sess)
 {
 	sess->SetInQueue(true);
+	sess->SetQueueTicket(m_queueHeadTicket + m_QueuedSessions.size());
 	m_QueuedSessions.push_back(sess);
+	++m_queuedSessionCount;
+
+	// every live session is ahead of the new one
+	sess->SetQueuePos(m_queuedSessionCount);
 
 	// [-ZERO] Possible wrong
 	// The 1st SMSG_AUTH_RESPONSE needs to contain other info too.
@@ -1309,7 +1543,7 @@ void World::AddSession_(WorldSession* s)
 {
 	ORIGIN_ASSERT(s);
 
-	// NOTE - Still there is race condition in WorldSession* being used in the Sockets
+	// sockets only reach the session through its SessionHandle, which goes stale when it is deleted here
 
 	///- kick already loaded player with same account (if any) and remove session
 	///- if player is in loading and want to load again, return
@@ -1365,30 +1599,14 @@ void World::AddSession_(WorldSession* s)
 	sLog.outDetail("sending AUTH_OK");
 	UpdateMaxSessionCounters();
 
-	// Updates the population
+	// Updates the population with the next flush
 	if (pLimit > 0)
-	{
-		float popu = float(GetActiveSessionCount());        // updated number of users on the server
-		popu /= pLimit;
-		popu *= 2;
-
-		static SqlStatementID id;
-
-		SqlStatement stmt = LoginDatabase.CreateStatement(id, "UPDATE realmlist SET population = ? WHERE id = ?");
-		stmt.PExecute(popu, realmID);
-
-		DETAIL_LOG("Server Population (%f).", popu);
-	}
+		m_populationChanged = true;
 }
 int32 World::GetQueuedSessionPos(WorldSession* sess)
 {
-	uint32 position = 1;
-
-	for (Queue::const_iterator iter = m_QueuedSessions.begin(); iter != m_QueuedSessions.end(); ++iter, ++position)
-		if ((*iter) == sess)
-			return position;
-
-	return 0;
+	// position as of the last batched update, the client has been told the same
+	return sess->IsInQueue() ? int32(sess->GetQueuePos()) : 0;
 }
 void World::UpdateSessions(uint32 /*diff*/)
 {
@@ -1403,8 +1621,21 @@ void World::UpdateSessions(uint32 /*diff*/)
 	}
 
 	///- Then send an update signal to remaining ones
-	for (SessionMap::iterator itr = m_sessions.begin(); itr != m_sessions.end(); )
+	// round robin: start one session further each tick, so that nobody is always served last
+	SessionMap::iterator itr = m_sessions.find(m_sessionUpdateCursor);
+	if (itr == m_sessions.end())
+		itr = m_sessions.begin();
+	if (itr != m_sessions.end())
+	{
+		SessionMap::iterator next = std::next(itr);
+		m_sessionUpdateCursor = next != m_sessions.end() ? next->first : 0;
+	}
+
+	for (size_t count = m_sessions.size(); count; --count)
 	{
+		if (itr == m_sessions.end())
+			itr = m_sessions.begin();
+
 		///- and remove not active sessions from the list
 		WorldSession* pSession = itr->second;
 		WorldSessionFilter updater(pSession);
@@ -1416,6 +1647,7 @@ void World::UpdateSessions(uint32 /*diff*/)
 			RemoveQueuedSession(pSession);
 			itr = m_sessions.erase(itr);
 			delete pSession;
+			m_populationChanged = true;
 		}
 		else
 			++itr;
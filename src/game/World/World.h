@@ -36,6 +36,7 @@
 #include <mutex>
 #include <functional>
 #include <vector>
+#include <atomic>
 
 class Object;
 class ObjectGuid;
@@ -78,7 +79,9 @@ enum WorldTimers
 	WUPDATE_EVENTS = 3,
 	WUPDATE_DELETECHARS = 4,
 	WUPDATE_AHBOT = 5,
-	WUPDATE_COUNT = 6
+	WUPDATE_QUEUE = 6,
+	WUPDATE_BOOKKEEPING = 7,
+	WUPDATE_COUNT = 8
 };
 
 /// Configuration elements
@@ -142,6 +145,9 @@ enum eConfigUInt32Values
 	CONFIG_UINT32_SKILL_GAIN_GATHERING,
 	CONFIG_UINT32_SKILL_GAIN_WEAPON,
 	CONFIG_UINT32_MAX_OVERSPEED_PINGS,
+	CONFIG_UINT32_SOCKET_HANDSHAKE_TIMEOUT,
+	CONFIG_UINT32_SOCKET_IDLE_TIMEOUT,
+	CONFIG_UINT32_SOCKET_PING_TIMEOUT,
 	CONFIG_UINT32_CHATFLOOD_MESSAGE_COUNT,
 	CONFIG_UINT32_CHATFLOOD_MESSAGE_DELAY,
 	CONFIG_UINT32_CHATFLOOD_MUTE_TIME,
@@ -176,6 +182,16 @@ enum eConfigUInt32Values
 	CONFIG_UINT32_GUID_RESERVE_SIZE_GAMEOBJECT,
 	CONFIG_UINT32_CREATURE_RESPAWN_AGGRO_DELAY,
 	CONFIG_UINT32_MAX_WHOLIST_RETURNS,
+	CONFIG_UINT32_QUEUE_UPDATE_INTERVAL,
+	CONFIG_UINT32_BOOKKEEPING_FLUSH_INTERVAL,
+	CONFIG_UINT32_PACKET_BUDGET_COUNT,
+	CONFIG_UINT32_PACKET_BUDGET_TIME,
+	CONFIG_UINT32_MAP_UPDATE_THREADS,
+	CONFIG_UINT32_MAP_HIBERNATE_DELAY,
+	CONFIG_UINT32_MAP_HIBERNATE_INTERVAL,
+	CONFIG_UINT32_VISIBILITY_LOD_MID_INTERVAL,
+	CONFIG_UINT32_VISIBILITY_LOD_FAR_INTERVAL,
+	CONFIG_UINT32_VISIBILITY_LOD_TICK_BUDGET,
 	CONFIG_UINT32_VALUE_COUNT
 };
 
@@ -259,6 +275,10 @@ enum eConfigFloatValues
 	CONFIG_FLOAT_THREAT_RADIUS,
 	CONFIG_FLOAT_GHOST_RUN_SPEED_WORLD,
 	CONFIG_FLOAT_GHOST_RUN_SPEED_BG,
+	CONFIG_FLOAT_VISIBILITY_CELL_SIZE,
+	CONFIG_FLOAT_VISIBILITY_LOD_NEAR_DISTANCE,
+	CONFIG_FLOAT_VISIBILITY_LOD_MID_DISTANCE,
+	CONFIG_FLOAT_MAP_REGION_SIZE,
 	CONFIG_FLOAT_VALUE_COUNT
 };
 
@@ -314,6 +334,7 @@ enum eConfigBoolValues
 	CONFIG_BOOL_PET_UNSUMMON_AT_MOUNT,
 	CONFIG_BOOL_MMAP_ENABLED,
 	CONFIG_BOOL_PLAYER_COMMANDS,
+	CONFIG_BOOL_MAP_HIBERNATE_RELEASE_BUFFERS,
 	CONFIG_BOOL_VALUE_COUNT
 };
 
@@ -400,8 +421,8 @@ public:
 	/// Get the number of current active sessions
 	void UpdateMaxSessionCounters();
 	uint32 GetActiveAndQueuedSessionCount() const { return m_sessions.size(); }
-	uint32 GetActiveSessionCount() const { return m_sessions.size() - m_QueuedSessions.size(); }
-	uint32 GetQueuedSessionCount() const { return m_QueuedSessions.size(); }
+	uint32 GetActiveSessionCount() const { return m_sessions.size() - m_queuedSessionCount; }
+	uint32 GetQueuedSessionCount() const { return m_queuedSessionCount; }
 	/// Get the maximum number of parallel sessions on the server since last reboot
 	uint32 GetMaxQueuedSessionCount() const { return m_maxQueuedSessionCount; }
 	uint32 GetMaxActiveSessionCount() const { return m_maxActiveSessionCount; }
@@ -414,10 +435,28 @@ public:
 	void SetPlayerLimit(int32 limit, bool needUpdate = false);
 
 	// player Queue
-	typedef std::list<WorldSession*> Queue;
+	typedef std::deque<WorldSession*> Queue;
 	void AddQueuedSession(WorldSession*);
 	bool RemoveQueuedSession(WorldSession* session);
 	int32 GetQueuedSessionPos(WorldSession*);
+	void UpdateQueuedSessionPositions();
+
+	/// Sessions which hit their per tick packet budget, and the packets they left for the next tick
+	void AddPacketBudgetOverrun(uint32 deferredPackets) { ++m_packetBudgetOverruns; m_packetBudgetDeferred += deferredPackets; }
+	uint64 GetPacketBudgetOverruns() const { return m_packetBudgetOverruns; }
+	uint64 GetPacketBudgetDeferred() const { return m_packetBudgetDeferred; }
+	/// Counts World::Update calls, a session spends one packet budget per tick over its map and world passes
+	uint32 GetUpdateTick() const { return m_updateTick; }
+
+	/// Packets whose handler could not parse them (too short, unterminated string)
+	void AddMalformedPacket() { ++m_malformedPackets; }
+	uint64 GetMalformedPacketCount() const { return m_malformedPackets; }
+
+	/// Realm bookkeeping (population, uptime, logged out accounts) is written in one batch per flush interval.
+	/// Nothing sets active_realm_id or characters.online at login, a login-side write added later has to
+	/// take the account out of the pending logouts in AddSession_ or the flush would undo it.
+	void QueueAccountLogout(uint32 accountId);
+	void FlushRealmBookkeeping();
 
 	/// \todo Actions on m_allowMovement still to be implemented
 	/// Is movement allowed?
@@ -527,6 +566,7 @@ public:
 
 	static float GetRelocationLowerLimitSq() { return m_relocation_lower_limit_sq; }
 	static uint32 GetRelocationAINotifyDelay() { return m_relocation_ai_notify_delay; }
+	static uint32 GetRelocationPlayerNotifyDelay() { return m_relocation_player_notify_delay; }
 
 	void InitServerMaintenanceCheck();
 	void ServerMaintenanceStart();
@@ -596,6 +636,11 @@ private:
 
 	typedef std::unordered_map<uint32, WorldSession*> SessionMap;
 	SessionMap m_sessions;
+	uint32 m_sessionUpdateCursor;                       // account id of the session updated first next tick
+	uint32 m_updateTick;
+	std::atomic<uint64> m_packetBudgetOverruns;
+	std::atomic<uint64> m_packetBudgetDeferred;
+	std::atomic<uint64> m_malformedPackets;
 	uint32 m_maxActiveSessionCount;
 	uint32 m_maxQueuedSessionCount;
 
@@ -623,13 +668,23 @@ private:
 
 	static float  m_relocation_lower_limit_sq;
 	static uint32 m_relocation_ai_notify_delay;
+	static uint32 m_relocation_player_notify_delay;
 
 	// CLI command holder to be thread safe
 	std::mutex m_cliCommandQueueLock;
 	std::deque<const CliCommandHolder *> m_cliCommandQueue;
 
-	// Player Queue
+	// Player Queue, slot of a session is its ticket - m_queueHeadTicket, nullptr for sessions which left the queue
 	Queue m_QueuedSessions;
+	uint32 m_queueHeadTicket;
+	uint32 m_queuedSessionCount;
+	bool m_queuePositionsChanged;
+
+	// bookkeeping waiting for the next FlushRealmBookkeeping
+	std::mutex m_bookkeepingLock;
+	std::vector<uint32> m_pendingLogoutAccounts;
+	bool m_populationChanged;
+	bool m_uptimeChanged;
 
 	// sessions that are added async
 	void AddSession_(WorldSession* s);
@@ -141,8 +141,11 @@ void CliRunnable::run()
 				continue;
 			}
 
-			//sWorld.QueueCliCommand(new CliCommandHolder(0, SEC_CONSOLE, command.c_str(), &utf8print, &commandFinished));
-			HandleCommande(command_str);
+			// account commands stay on this thread, everything else runs on the world thread between ticks
+			if (!strncmp(command_str, ".account", 8))
+				HandleCommande(command_str);
+			else
+				sWorld.QueueCliCommand(new CliCommandHolder(0, SEC_CONSOLE, command.c_str(), &utf8print, &commandFinished));
 		}
 		else if (feof(stdin))
 		{
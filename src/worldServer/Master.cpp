@@ -4,6 +4,7 @@
 
 #include <Timer.h>
 #include <Util/Util.h>
+#include <Util/Watchdog.h>
 #include <Log.h>
 #include <Config\Config.h>
 #include <Network/Listener.h>
@@ -11,6 +12,7 @@
 
 
 #include <World\World.h>
+#include <Server/PacketCapture.h>
 
 INSTANTIATE_SINGLETON_1(Master);
 volatile uint32 Master::m_masterLoopCounter = 0;
@@ -81,11 +83,28 @@ public:
 			else if (WorldTimer::getMSTimeDiff(w_lastchange, curtime) > _delaytime)
 			{
 				sLog.outError("World Thread hangs, kicking out server!");
-				*((uint32 volatile*)nullptr) = 0;          // bang crash
+				Stalled();
+			}
+
+			// world loop may still spin while a network or map thread is stuck in one phase
+			int stalled = Origin::Watchdog::FindStalledThread(_delaytime);
+			if (stalled >= 0)
+			{
+				sLog.outError("Watched thread %d hangs, kicking out server!", stalled);
+				Stalled();
 			}
 		}
+		if (Origin::Watchdog::GetNearStallCount())
+			Origin::Watchdog::DumpBreadcrumbs();
 		sLog.outString("Anti-freeze thread exiting without problems.");
 	}
+private:
+	// dump what every watched thread was doing, then abort so a core dump is written
+	void Stalled()
+	{
+		Origin::Watchdog::DumpBreadcrumbs();
+		abort();
+	}
 };
 
 /// Clear 'online' status for all accounts with characters in this realm
@@ -125,6 +144,8 @@ int Master::Run()
 	WorldDatabase.AllowAsyncTransactions();
 	LoginDatabase.AllowAsyncTransactions();
 
+	Origin::Watchdog::SetNearStallTime(sConfig.GetIntDefault("Watchdog.NearStallTime", 50));
+
 	///- Launch WorldRunnable thread
 	Origin::Thread world_thread(new WorldRunnable);
 	world_thread.setPriority(Origin::Priority_Highest);
@@ -150,7 +171,12 @@ int Master::Run()
 	}
 	{
 		//auto const listenIP = sConfig.GetStringDefault("BindIP", "0.0.0.0");
-		Origin::Listener<WorldSocket> listener(sWorld.getConfig(CONFIG_UINT32_PORT_WORLD), 8);
+		// a replayed capture runs headless, real clients would mix into the replayed load
+		std::unique_ptr<Origin::Listener<WorldSocket>> listener;
+		if (sPacketReplay.IsReplaying())
+			sLog.outString("Replaying a packet capture, world port is not opened");
+		else
+			listener.reset(new Origin::Listener<WorldSocket>(sWorld.getConfig(CONFIG_UINT32_PORT_WORLD), 8));
 
 		/*std::unique_ptr<Origin::Listener<RASocket>> raListener;
 		if (sConfig.GetBoolDefault("Ra.Enable", false))
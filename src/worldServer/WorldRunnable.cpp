@@ -2,6 +2,7 @@
 #include "World.h"
 #include "WorldRunnable.h"
 #include <Timer.h>
+#include <Watchdog.h>
 //#include "ObjectAccessor.h"
 
 #include <Database/DatabaseEnv.h>
@@ -18,6 +19,7 @@ void WorldRunnable::run()
 {
 	///- Init new SQL thread for the world database
 	WorldDatabase.ThreadStart();                            // let thread do safe mySQL requests (one connection call enough)
+	Origin::Watchdog::RegisterThread("World", Origin::WATCHDOG_THREAD_WORLD);
 	//sWorld.InitResultQueue();
 
 	uint32 realCurrTime = 0;
@@ -33,7 +35,10 @@ void WorldRunnable::run()
 
 		uint32 diff = WorldTimer::tick();
 
-		sWorld.Update(diff);
+		{
+			Origin::WatchdogPhase phase("World::Update");
+			sWorld.Update(diff);
+		}
 		realPrevTime = realCurrTime;
 
 		// diff (D0) include time of previous sleep (d0) + tick time (t0)
@@ -51,6 +56,7 @@ void WorldRunnable::run()
 		Sleep(1000);
 	}
 	sWorld.CleanupsBeforeStop();
+	Origin::Watchdog::UnregisterThread();
 
 															///- End the database thread
 	WorldDatabase.ThreadEnd();                              // free mySQL thread resources